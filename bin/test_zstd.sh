@@ -0,0 +1,31 @@
+#! /bin/bash
+# zstd round trip : sy<num>r.csv and syn<num>.csv compressed with zstd must route the same as the plain files
+# ./fpga has to be built with -DUSE_ZSTD -lzstd (see ../src/Makefile), the zstd command is needed to compress
+num=${1:-1}
+bench=../../benchmark/testcase_new
+work=$(mktemp -d)
+
+for kind in plain zstd
+do
+    mkdir -p $work/$kind/benchmark/testcase_new $work/$kind/run/bin $work/$kind/run/output
+    cp fpga $work/$kind/run/bin/
+done
+cp $bench/sy${num}r.csv $bench/syn${num}.csv $work/plain/benchmark/testcase_new/
+zstd -q -c $bench/sy${num}r.csv > $work/zstd/benchmark/testcase_new/sy${num}r.csv
+zstd -q -c $bench/syn${num}.csv > $work/zstd/benchmark/testcase_new/syn${num}.csv
+
+for kind in plain zstd
+do
+    (cd $work/$kind/run/bin && ./fpga $num) | grep -E "error|cost|MAX TDM|routed" | sed "s/time = .*//" > $work/$kind.log
+done
+
+if [ -s $work/plain.log ] && diff $work/plain.log $work/zstd.log
+then
+    echo "zstd round trip OK"
+    result=0
+else
+    echo "zstd round trip FAILED"
+    result=1
+fi
+rm -rf $work
+exit $result
@@ -10,6 +10,45 @@ bool comp_sbnetcost(const pair<SubNet, int> &lhs, const pair<SubNet, int> &rhs)
     return lhs.second > rhs.second;
 }
 
+bool comp_sbref_weight(const SubNet_Ref &lhs, const SubNet_Ref &rhs)
+{
+    return lhs.weight > rhs.weight;
+}
+
+void sort_subnet_order(vector<SubNet_Ref> &order)
+{
+    //heaviest first, subnets of the same weight keep net / sink order
+    //(std::sort used to leave ties in a library dependent order, so the routes are not the same as with it)
+    //sink weights are small integers, so a counting sort over the weight range is used
+    if (order.size() < 2)
+        return;
+
+    int min_w = INT_MAX, max_w = INT_MIN;
+    for (const auto &r : order)
+    {
+        min_w = min(min_w, r.weight);
+        max_w = max(max_w, r.weight);
+    }
+
+    const long long range = (long long)max_w - min_w + 1;
+    if (range > (long long)order.size() * 4 + 1024)
+    {
+        stable_sort(order.begin(), order.end(), comp_sbref_weight);
+        return;
+    }
+
+    vector<size_t> bucket(range + 1, 0);
+    for (const auto &r : order)
+        bucket[max_w - r.weight + 1]++;
+    for (long long w = 0; w < range; w++)
+        bucket[w + 1] += bucket[w];
+
+    vector<SubNet_Ref> sorted(order.size());
+    for (const auto &r : order)
+        sorted[bucket[max_w - r.weight]++] = r;
+    order.swap(sorted);
+}
+
 bool comp_netcrit(const Net &lhs, const Net &rhs)
 {
     return lhs.criticality > rhs.criticality;
@@ -25,7 +64,7 @@ bool comp_edges(const Net &lhs, const Net &rhs)
     return lhs.total_tree_edge > rhs.total_tree_edge;
 }
 
-bool comp_hops(const Table_content &lhs, const Table_content &rhs)
+bool comp_hops(const Table_build_content &lhs, const Table_build_content &rhs)
 {
     return lhs.hops < rhs.hops;
 }
@@ -35,7 +74,12 @@ bool comp_by_second(const pair<Net *, double> &lhs, const pair<Net *, double> &r
     return lhs.second > rhs.second;
 }
 
-bool comp_conj_vec_map(const pair<pair<int, int>, int> &lhs, const pair<pair<int, int>, int> &rhs)
+bool comp_by_first(const pair<int, int> &lhs, const pair<int, int> &rhs)
+{
+    return lhs.first < rhs.first;
+}
+
+bool comp_conj_vec_map(const pair<int, int> &lhs, const pair<int, int> &rhs)
 {
     return lhs.second > rhs.second;
 }
@@ -86,50 +130,28 @@ void show_tree(Tree_Node *root)
     }
 }
 
-void delete_tree(Tree_Node *root)
+bool refresh_max_value(Tree_Node *cur) //max value = max sink weight in the subtree (at least 0), return true if it changed
 {
-    queue<Tree_Node *> fifo_queue;
-    fifo_queue.push(root);
-
-    while (fifo_queue.size() != 0)
+    int max = 0;
+    for (const auto &child : cur->children)
     {
-        Tree_Node *cur = fifo_queue.front();
-        fifo_queue.pop();
+        if (child->max_value > max)
+            max = child->max_value;
+    }
 
-        if (cur->children.size() == 0)
-            continue;
+    const int value = (max > cur->sink_weight) ? max : cur->sink_weight;
+    if (value == cur->max_value && value == cur->edge_weight)
+        return false;
 
-        for (const auto &child : cur->children)
-        {
-            fifo_queue.push(child);
-        }
-        delete cur;
-    }
+    cur->max_value = value;
+    cur->edge_weight = value;
+    return true;
 }
 
-int max_weight(Tree_Node *root) //return max sink weight value of all subtree
+void update_max_value(Tree_Node *node) //carry a change of node's children up to the root, stops at the first unchanged node
 {
-    int max = 0;
-    queue<Tree_Node *> fifo_queue;
-    fifo_queue.push(root);
-
-    while (fifo_queue.size() != 0)
-    {
-        Tree_Node *cur = fifo_queue.front();
-        fifo_queue.pop();
-
-        for (auto &child : cur->children)
-        {
-            if (child->sink_weight > max)
-            {
-                max = child->sink_weight;
-            }
-
-            fifo_queue.push(child);
-        }
-    }
-
-    return max;
+    for (Tree_Node *cur = node; cur != NULL && refresh_max_value(cur); cur = cur->parent)
+        ;
 }
 
 double diff_weight_es(Tree_Node *root) //return tree的edge weight平均 與 sink weight平均 的 差
@@ -179,198 +201,859 @@ pair<int, int> get_channel_name(int x, int y)
     return make_pair(s, t);
 }
 
-Tree_Node *search_node(Tree_Node *root, int key)
+void parallel_for(const int &n, const int &thread_num, const function<void(const int &)> &job)
 {
-    Tree_Node *current = root;
-
-    if (current->fpga_id == key)
+    //run job(0) ~ job(n - 1) on thread_num threads, tasks are handed out one by one
+    int worker_num = std::min(thread_num, n);
+    if (worker_num <= 1)
     {
-        return current;
+        for (int i = 0; i < n; i++)
+            job(i);
+        return;
     }
 
-    queue<Tree_Node *> fifo_queue;
-    fifo_queue.push(current);
+    atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next++; i < n; i = next++)
+            job(i);
+    };
+
+    vector<thread> pool;
+    for (int t = 1; t < worker_num; t++)
+        pool.emplace_back(worker);
+    worker();
+    for (auto &th : pool)
+        th.join();
+}
 
-    while (fifo_queue.size() != 0 && current != NULL && current->fpga_id != key)
+void add_table_content(Table_build_cell &cell, const int &hops, const int &par, const int &rev_par)
+{
+    for (auto &tc : cell)
     {
-        current = fifo_queue.front();
-        fifo_queue.pop();
-
-        if (current->children.size() != 0)
+        if (tc.hops == hops) //看看是否已有相同hop數的解
         {
-            for (auto child : current->children)
+            if (find(tc.parent.begin(), tc.parent.end(), par) == tc.parent.end())
             {
-                if (child->fpga_id != key)
-                {
-                    fifo_queue.push(child);
-                }
-                else
-                {
-                    return child;
-                }
+                tc.parent.push_back(par);
             }
+            if (find(tc.rev_parent.begin(), tc.rev_parent.end(), rev_par) == tc.rev_parent.end())
+            {
+                tc.rev_parent.push_back(rev_par);
+            }
+            return;
         }
     }
 
-    return nullptr;
+    Table_build_content temp;
+    temp.hops = hops;
+    temp.parent.push_back(par);
+    temp.rev_parent.push_back(rev_par);
+    cell.push_back(temp);
 }
 
 void FPGA_Gr::getfile(char *sysfile, char *netfile)
+{
+    read_system_file(sysfile);
+    read_netlist(netfile);
+}
+
+void FPGA_Gr::read_system_file(char *sysfile)
 {
     vector<int> fpgas, fpga_nbr, pair;
     FILE *fr;
     int f1, f2;
     int fu1, fm1, ff1, fu2, fm2, ff2, pairs;
-    fr = fopen(sysfile, "r");
+    const char *link_format = "U%d/M%d/F%d[SLR%*d]---U%d/M%d/F%d[SLR%*d], pairs=%d\n";
 
-    while (!feof(fr))
+    if (Decompress_Stream::detect(sysfile) != Decompress_Stream::PLAIN)
     {
-        int mak = fscanf(fr, "U%d/M%d/F%d[SLR%*d]---U%d/M%d/F%d[SLR%*d], pairs=%d\n", &fu1, &fm1, &ff1, &fu2, &fm2, &ff2, &pairs);
-        f1 = 100 * fu1 + 10 * fm1 + 1 * ff1;
-        f2 = 100 * fu2 + 10 * fm2 + 1 * ff2;
-        fpgas.push_back(f1);
-        fpga_nbr.push_back(f2);
-        pair.push_back(pairs);
+        //compressed system file is small, decode it at once and parse it line by line
+        string text;
+        Decompress_Stream in(sysfile);
+        char buf[1 << 16];
+        for (size_t len; (len = in.read(buf, sizeof(buf))) > 0;)
+            text.append(buf, len);
+
+        char *p = &text[0];
+        char *last = p + text.size();
+        for (int line_num = 1; p < last; line_num++)
+        {
+            char *eol = (char *)memchr(p, '\n', last - p);
+            if (eol == NULL)
+                eol = last;
+            *eol = '\0'; //sscanf only sees this line
+
+            const bool blank = strspn(p, " \t\r") == (size_t)(eol - p);
+            if (!blank)
+            {
+                if (sscanf(p, link_format, &fu1, &fm1, &ff1, &fu2, &fm2, &ff2, &pairs) != 7)
+                {
+                    cout << "[error] function(read_system_file) bad link at line " << line_num << " of " << sysfile << endl;
+                    exit(1);
+                }
+                fpgas.push_back(100 * fu1 + 10 * fm1 + 1 * ff1);
+                fpga_nbr.push_back(100 * fu2 + 10 * fm2 + 1 * ff2);
+                pair.push_back(pairs);
+            }
+            p = eol + 1;
+        }
     }
+    else
+    {
+        fr = fopen(sysfile, "r");
 
-    fclose(fr);
+        while (!feof(fr))
+        {
+            int mak = fscanf(fr, link_format, &fu1, &fm1, &ff1, &fu2, &fm2, &ff2, &pairs);
+            f1 = 100 * fu1 + 10 * fm1 + 1 * ff1;
+            f2 = 100 * fu2 + 10 * fm2 + 1 * ff2;
+            fpgas.push_back(f1);
+            fpga_nbr.push_back(f2);
+            pair.push_back(pairs);
+        }
+
+        fclose(fr);
+    }
 
-    fpga_num = fpgas.back() + 1;
+    build_topology(fpgas, fpga_nbr, pair);
+}
+
+void FPGA_Gr::read_netlist(char *netfile)
+{
+    //read net
+    double total_sink_weight = read_net_file(netfile);
+    finish_netlist(total_sink_weight);
+}
+
+void FPGA_Gr::build_topology(const vector<int> &fpgas, const vector<int> &fpga_nbr, const vector<int> &pair)
+{
+    //map 100 * U + 10 * M + F to compact fpga id (same order as the code)
+    vector<int> codes = fpgas;
+    codes.insert(codes.end(), fpga_nbr.begin(), fpga_nbr.end());
+    sort(codes.begin(), codes.end());
+    codes.erase(unique(codes.begin(), codes.end()), codes.end());
+
+    fpga_num = codes.size();
     fpga.resize(fpga_num);
+    code_to_id.assign(codes.back() + 1, -1);
+
+    for (int i = 0; i < fpga_num; i++)
+    {
+        fpga[i].id = i;
+        fpga[i].code = codes[i];
+        code_to_id[codes[i]] = i;
+    }
 
-    for (int i = 0; i < fpgas.size(); i++)
+    //construct CSR adjacency (each row sorted by nbr fpga id)
+    vector<tuple<int, int, int>> links; //(fpga, nbr fpga, pairs)
+    for (size_t i = 0; i < fpgas.size(); i++)
     {
-        int id = fpgas[i];
-        int nbr_id = fpga_nbr[i];
-        pairs = pair[i];
+        links.push_back(make_tuple(code_to_id[fpgas[i]], code_to_id[fpga_nbr[i]], pair[i]));
+    }
+    sort(links.begin(), links.end());
 
-        fpga[id].id = id;
+    graph.offset.assign(fpga_num + 1, 0);
+    for (size_t i = 0; i < links.size(); i++)
+    {
+        const int &id = get<0>(links[i]);
+        const int &nbr_id = get<1>(links[i]);
 
-        if (fpga[id].nbr_pair.size() == 0)
+        if (i > 0 && id == get<0>(links[i - 1]) && nbr_id == get<1>(links[i - 1]))
         {
-            fpga[id].nbr_pair.push_back(make_pair(nbr_id, pairs));
-        }
-        else if (nbr_id != fpga[id].nbr_pair.back().first)
-        {
-            fpga[id].nbr_pair.push_back(make_pair(nbr_id, pairs));
+            graph.pairs.back() += get<2>(links[i]);
+            continue;
         }
-        else
+
+        graph.nbr.push_back(nbr_id);
+        graph.pairs.push_back(get<2>(links[i]));
+        graph.offset[id + 1]++;
+    }
+
+    for (int i = 0; i < fpga_num; i++)
+    {
+        graph.offset[i + 1] += graph.offset[i];
+    }
+
+    int interconnect = graph.nbr.size() / 2;
+
+    //assign edge id to every channel (sorted by channel name)
+    for (int i = 0; i < fpga_num; i++)
+    {
+        for (int k = graph.offset[i]; k < graph.offset[i + 1]; k++)
         {
-            fpga[id].nbr_pair.back().second += pairs;
+            edge_name.push_back(get_channel_name(i, graph.nbr[k]));
         }
     }
+    sort(edge_name.begin(), edge_name.end());
+    edge_name.erase(unique(edge_name.begin(), edge_name.end()), edge_name.end());
+    edge_num = edge_name.size();
 
-    int interconnect = 0;
-    for (auto &f : fpga) //record index
+    graph.edge.resize(graph.nbr.size());
+    for (int i = 0; i < fpga_num; i++)
     {
-        for (size_t i = 0; i < f.nbr_pair.size(); i++)
+        for (int k = graph.offset[i]; k < graph.offset[i + 1]; k++)
         {
-            const int &fid = f.nbr_pair[i].first;
-            f.nbr_index[fid] = i;
-            interconnect++;
+            auto ch_name = get_channel_name(i, graph.nbr[k]);
+            graph.edge[k] = lower_bound(edge_name.begin(), edge_name.end(), ch_name) - edge_name.begin();
         }
     }
 
-    interconnect /= 2;
+    //capacity is derived from the size of the 100 * U + 10 * M + F code space
+    int code_num = code_to_id.size();
+    capacity = interconnect % 100 * 1000 / code_num % 10 * 10;
 
     cout << endl;
     cout << "#FPGAs = " << fpga.size() << endl;
     cout << "#interconnections = " << interconnect << endl;
 
     /*
-    for (auto &f : fpga)
+    for (int i = 0; i < fpga_num; i++)
     {
-        for (auto &nbr_f : f.nbr_pair)
+        for (int k = graph.offset[i]; k < graph.offset[i + 1]; k++)
         {
-            //cout << "F" << f.id << "-------"
-                 << "F" << nbr_f.first << ", pairs = " << nbr_f.second << endl;
+            cout << fpga[i].name() << "-------"
+                 << fpga[graph.nbr[k]].name() << ", pairs = " << graph.pairs[k] << endl;
         }
     }
     */
+}
 
-    //read net
-    fstream file;
-    file.open(netfile);
-    string line;
-    int id = 0;
-    double total_sink_weight = 0.0;
+void FPGA_Gr::finish_netlist(const double &total_sink_weight)
+{
+    avg_sk_weight = total_sink_weight / (double)sink_num;
+
+    cout << "#signals = " << net.size() << endl;
+    cout << "capacity = " << capacity << endl;
+    cout << endl;
+
+    repeat_RR.resize(net.size());
+
+    /*
+    for (auto &n : net)
+    {
+        //cout << net_name.get(n.name_id) << endl;
+        //cout << "source = " << n.source << endl;
+        for (auto &s : n.sink)
+        {
+            //cout << s.id << ", w = " << s.weight << endl;
+        }
+        //cout << endl;
+    }
+    */
+
+    //srand(time(NULL));
+    //random_shuffle(net.begin(), net.end());
+}
+
+int parse_field_int(const char *p, const char *end)
+{
+    //same as atoi on the field, but stops at the end of the field
+    while (p < end && isspace((unsigned char)*p))
+        p++;
+
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = (*p++ == '-');
+
+    int val = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+        val = val * 10 + (*p - '0');
+
+    return neg ? -val : val;
+}
+
+double FPGA_Gr::parse_net_line(const char *p, const char *end, Net &n, pair<const char *, const char *> &name)
+{
+    //fields : source, sinks..., name (has '_' after the first char), weights of sinks...
+    //the field after the last ',' is dropped if empty, as getline(.., ',') did
+    bool named = false, src = false;
+    size_t w = 0;
+    double total_weight = 0.0;
+
+    n.sink.reserve(count(p, end, ',') + 1);
+
+    while (p < end)
+    {
+        const char *field_end = (const char *)memchr(p, ',', end - p);
+        const bool last = field_end == NULL;
+        if (last)
+            field_end = end;
+
+        const char *us = (const char *)memchr(p, '_', field_end - p);
+        if (us != NULL && us > p)
+        {
+            name = make_pair(p, field_end);
+            named = true;
+        }
+        else if (named)
+        {
+            if (w < n.sink.size())
+            {
+                n.sink[w].weight = parse_field_int(p, field_end);
+                n.total_sink_weight += n.sink[w].weight;
+                total_weight += n.sink[w].weight;
+            }
+            w++;
+        }
+        else if (!src) //還沒讀source
+        {
+            n.source = fpga_index(parse_field_int(p, field_end));
+            src = true;
+        }
+        else
+        {
+            Sink tmp_s;
+            tmp_s.id = fpga_index(parse_field_int(p, field_end));
+            tmp_s.weight = 0;
+            n.sink.push_back(tmp_s);
+        }
+
+        if (last)
+            break;
+        p = field_end + 1;
+    }
+
+    return total_weight;
+}
+
+Decompress_Stream::Format Decompress_Stream::detect(const char *file)
+{
+    unsigned char magic[4] = {0, 0, 0, 0};
+    FILE *fr = fopen(file, "rb");
+    if (fr == NULL)
+        return PLAIN;
+    size_t len = fread(magic, 1, 4, fr);
+    fclose(fr);
 
-    while (getline(file, line, '\n'))
+    if (len >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+        return GZIP;
+    if (len == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+        return ZSTD;
+    return PLAIN;
+}
+
+Decompress_Stream::Decompress_Stream(const char *file)
+{
+    format = detect(file);
+    gz = NULL;
+
+    if (format == ZSTD)
     {
-        Net n;
-        n.id = id++;
-        istringstream templine(line);
-        string data;
-        int ctrl = 0;
-        bool src = false;
-        vector<int> tc;
-        vector<int> t_weight;
+#ifdef USE_ZSTD
+        fin = fopen(file, "rb");
+        zs = ZSTD_createDStream();
+        if (fin == NULL || zs == NULL)
+        {
+            cout << "[error] function(Decompress_Stream) cannot open " << file << endl;
+            exit(1);
+        }
+        ZSTD_initDStream(zs);
+        in_buf.resize(ZSTD_DStreamInSize());
+        in.src = in_buf.data();
+        in.size = in.pos = 0;
+        zs_ret = 0;
+#else
+        cout << "[error] function(Decompress_Stream) " << file << " is zstd compressed, build with -DUSE_ZSTD -lzstd to read it" << endl;
+        exit(1);
+#endif
+        return;
+    }
 
-        while (getline(templine, data, ','))
+    //gzread passes plain files through unchanged
+    gz = gzopen(file, "rb");
+    if (gz == NULL)
+    {
+        cout << "[error] function(Decompress_Stream) cannot open " << file << endl;
+        exit(1);
+    }
+    gzbuffer(gz, 1 << 17);
+}
+
+Decompress_Stream::~Decompress_Stream()
+{
+    if (gz != NULL)
+        gzclose(gz);
+#ifdef USE_ZSTD
+    if (format == ZSTD)
+    {
+        ZSTD_freeDStream(zs);
+        fclose(fin);
+    }
+#endif
+}
+
+size_t Decompress_Stream::read(char *buf, const size_t &cap)
+{
+#ifdef USE_ZSTD
+    if (format == ZSTD)
+    {
+        ZSTD_outBuffer out = {buf, cap, 0};
+        while (out.pos < out.size)
         {
-            int current = 0;
-            int pos = data.find_first_of("_", current);
-            if (pos > 0)
+            bool eof = false;
+            if (in.pos == in.size)
             {
-                n.name = data;
-                ctrl = 1;
+                in.size = fread(in_buf.data(), 1, in_buf.size(), fin);
+                in.pos = 0;
+                eof = (in.size == 0);
             }
-            else if (ctrl == 1)
+
+            const size_t last_pos = out.pos;
+            const size_t ret = ZSTD_decompressStream(zs, &out, &in);
+            if (ZSTD_isError(ret))
             {
-                t_weight.push_back(atoi(data.c_str()));
+                cout << "[error] function(Decompress_Stream::read) " << ZSTD_getErrorName(ret) << endl;
+                exit(1);
             }
-            else
+
+            //no input left and nothing flushed, a complete frame asks for the next frame header here,
+            //so the stream ends well only if the call before returned 0 (frame complete)
+            if (eof && out.pos == last_pos)
             {
-                if (!src) //還沒讀source
+                if (zs_ret != 0)
                 {
-                    n.source = atoi(data.c_str());
-                    src = true;
-                }
-                else
-                {
-                    Sink tmp_s;
-                    tmp_s.id = atoi(data.c_str());
-                    n.sink.push_back(tmp_s);
+                    cout << "[error] function(Decompress_Stream::read) zstd stream is truncated" << endl;
+                    exit(1);
                 }
+                break;
             }
+            zs_ret = ret;
         }
+        return out.pos;
+    }
+#endif
 
-        for (size_t i = 0; i < n.sink.size(); i++)
+    int len = gzread(gz, buf, cap);
+    if (len < 0)
+    {
+        int err;
+        cout << "[error] function(Decompress_Stream::read) " << gzerror(gz, &err) << endl;
+        exit(1);
+    }
+    return len;
+}
+
+double FPGA_Gr::read_net_stream(const char *netfile)
+{
+    //a decoder thread fills blocks while this thread parses the complete lines of them,
+    //net ids follow the line order as in read_net_file
+    const size_t block_size = 1 << 22;
+    const size_t max_ready = 4;
+    deque<string> ready;
+    bool done = false;
+    mutex block_mutex;
+    condition_variable block_cv;
+
+    thread decoder([&]() {
+        Decompress_Stream in(netfile);
+        while (true)
         {
-            n.sink[i].weight = t_weight[i];
-            n.total_sink_weight += t_weight[i];
-            total_sink_weight += t_weight[i];
-            sink_num++;
+            string block(block_size, '\0');
+            size_t len = in.read(&block[0], block_size);
+            if (len == 0)
+                break;
+            block.resize(len);
+
+            unique_lock<mutex> lock(block_mutex);
+            block_cv.wait(lock, [&]() { return ready.size() < max_ready; });
+            ready.push_back(move(block));
+            block_cv.notify_all();
+        }
+
+        lock_guard<mutex> lock(block_mutex);
+        done = true;
+        block_cv.notify_all();
+    });
+
+    double total_sink_weight = 0.0;
+    net_name.data.clear();
+    net_name.off.assign(1, 0);
+
+    auto parse_line = [&](const char *p, const char *line_end) {
+        net.emplace_back();
+        Net &n = net.back();
+        n.id = net.size() - 1;
+        n.name_id = n.id;
+
+        pair<const char *, const char *> name(line_end, line_end);
+        total_sink_weight += parse_net_line(p, line_end, n, name);
+        sink_num += n.sink.size();
+        net_name.data.append(name.first, name.second);
+        net_name.off.push_back(net_name.data.size());
+    };
+
+    string carry; //unfinished line of the last block
+    while (true)
+    {
+        string block;
+        {
+            unique_lock<mutex> lock(block_mutex);
+            block_cv.wait(lock, [&]() { return !ready.empty() || done; });
+            if (ready.empty())
+                break;
+            block = move(ready.front());
+            ready.pop_front();
+            block_cv.notify_all();
+        }
+
+        const char *p = block.data();
+        const char *end = p + block.size();
+        if (!carry.empty())
+        {
+            const char *line_end = (const char *)memchr(p, '\n', end - p);
+            if (line_end == NULL)
+            {
+                carry.append(p, end);
+                continue;
+            }
+            carry.append(p, line_end);
+            parse_line(carry.data(), carry.data() + carry.size());
+            carry.clear();
+            p = line_end + 1;
+        }
+
+        while (p < end)
+        {
+            const char *line_end = (const char *)memchr(p, '\n', end - p);
+            if (line_end == NULL)
+            {
+                carry.assign(p, end);
+                break;
+            }
+            parse_line(p, line_end);
+            p = line_end + 1;
         }
+    }
+    decoder.join();
 
-        net.push_back(n);
+    //a last line without '\n' counts too
+    if (!carry.empty())
+        parse_line(carry.data(), carry.data() + carry.size());
+
+    return total_sink_weight;
+}
+
+double FPGA_Gr::read_net_file(const char *netfile)
+{
+    if (Decompress_Stream::detect(netfile) != Decompress_Stream::PLAIN)
+        return read_net_stream(netfile);
+
+    //map the whole file and parse every line in place into the preallocated net vector
+    int fd = open(netfile, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        cout << "[error] function(getfile) cannot open net file " << netfile << endl;
+        exit(1);
     }
 
-    avg_sk_weight = total_sink_weight / (double)sink_num;
+    size_t size = st.st_size;
+    const char *data = NULL;
+    if (size > 0)
+    {
+        data = (const char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            cout << "[error] function(getfile) cannot map net file " << netfile << endl;
+            exit(1);
+        }
+        madvise((void *)data, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    //split the file into chunks on line boundaries, one net per line (a last line without '\n' counts too)
+    const char *end = data + size;
+    const int chunk_num = std::max(1, (int)std::min<size_t>(thread_num, size / (1 << 20)));
+    vector<const char *> chunk(chunk_num + 1, end);
+    chunk[0] = data;
+    for (int c = 1; c < chunk_num; c++)
+    {
+        const char *p = std::max(chunk[c - 1], data + size / chunk_num * c);
+        const char *line_end = (const char *)memchr(p, '\n', end - p);
+        chunk[c] = line_end == NULL ? end : line_end + 1;
+    }
 
-    capacity = interconnect % 100 * 1000 / fpga_num % 10 * 10;
+    //count lines of every chunk, the prefix sum gives the id of the first net in each chunk
+    vector<size_t> first_id(chunk_num + 1, 0);
+    parallel_for(chunk_num, thread_num, [&](const int &c) {
+        size_t line_num = count(chunk[c], chunk[c + 1], '\n');
+        if (chunk[c + 1] > chunk[c] && chunk[c + 1][-1] != '\n')
+            line_num++;
+        first_id[c + 1] = line_num;
+    });
+    for (int c = 0; c < chunk_num; c++)
+        first_id[c + 1] += first_id[c];
+    net.resize(first_id[chunk_num]);
+
+    //parse chunks, sink counts and weights are summed in chunk order
+    vector<pair<const char *, const char *>> name_field(net.size(), make_pair(end, end));
+    vector<double> chunk_weight(chunk_num, 0.0);
+    vector<int> chunk_sink_num(chunk_num, 0);
+    parallel_for(chunk_num, thread_num, [&](const int &c) {
+        const char *p = chunk[c];
+        for (size_t id = first_id[c]; id < first_id[c + 1]; id++)
+        {
+            const char *line_end = (const char *)memchr(p, '\n', chunk[c + 1] - p);
+            if (line_end == NULL)
+                line_end = chunk[c + 1];
 
-    cout << "#signals = " << net.size() << endl;
-    cout << "capacity = " << interconnect % 100 * 1000 / fpga_num % 10 * 10 << endl;
-    cout << endl;
+            Net &n = net[id];
+            n.id = id;
+            n.name_id = id;
+            chunk_weight[c] += parse_net_line(p, line_end, n, name_field[id]);
+            chunk_sink_num[c] += n.sink.size();
 
-    repeat_RR.resize(net.size());
+            p = line_end + 1;
+        }
+    });
 
-    /*
-    for (auto &n : net)
+    double total_sink_weight = 0.0;
+    for (int c = 0; c < chunk_num; c++)
     {
-        //cout << n.name << endl;
-        //cout << "source = " << n.source << endl;
-        for (auto &s : n.sink)
+        total_sink_weight += chunk_weight[c];
+        sink_num += chunk_sink_num[c];
+    }
+
+    //intern net names in net order
+    net_name.off.assign(net.size() + 1, 0);
+    for (size_t id = 0; id < net.size(); id++)
+    {
+        net_name.off[id + 1] = net_name.off[id] + (name_field[id].second - name_field[id].first);
+    }
+    net_name.data.resize(net_name.off[net.size()]);
+    parallel_for(chunk_num, thread_num, [&](const int &c) {
+        for (size_t id = first_id[c]; id < first_id[c + 1]; id++)
+            memcpy(&net_name.data[net_name.off[id]], name_field[id].first, name_field[id].second - name_field[id].first);
+    });
+
+    if (data != NULL)
+        munmap((void *)data, size);
+
+    return total_sink_weight;
+}
+
+//binary netlist layout : header, sink_off[net_num + 1], name_off[net_num + 1], links[link_num][3] (fpga, nbr fpga, pairs),
+//source[net_num], sinks[sink_num][2] (fpga, weight), names[name_bytes]
+//fpgas are stored as 100 * U + 10 * M + F, net i owns sinks sink_off[i] ~ sink_off[i + 1] - 1 and name name_off[i] ~ name_off[i + 1] - 1
+struct Netlist_bin_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t link_num;
+    uint64_t net_num;
+    uint64_t sink_num;
+    uint64_t name_bytes;
+};
+
+static const char netlist_bin_magic[8] = {'F', 'P', 'G', 'A', 'N', 'E', 'T', 'S'};
+
+void FPGA_Gr::write_netlist_bin(const char *file)
+{
+    //links are written from the CSR graph, building it again gives the same graph
+    vector<int32_t> links;
+    for (int i = 0; i < fpga_num; i++)
+    {
+        for (int k = graph.offset[i]; k < graph.offset[i + 1]; k++)
         {
-            //cout << s.id << ", w = " << s.weight << endl;
+            links.push_back(fpga[i].code);
+            links.push_back(fpga[graph.nbr[k]].code);
+            links.push_back(graph.pairs[k]);
         }
-        //cout << endl;
     }
-    */
 
-    //srand(time(NULL));
-    //random_shuffle(net.begin(), net.end());
+    vector<uint32_t> sink_off(1, 0), name_off(1, 0);
+    vector<int32_t> source, sinks;
+    string names;
+    for (const auto &n : net)
+    {
+        source.push_back(n.source < 0 ? -1 : fpga[n.source].code); //empty line
+        for (const auto &sk : n.sink)
+        {
+            sinks.push_back(fpga[sk.id].code);
+            sinks.push_back(sk.weight);
+        }
+        names += net_name.get(n.name_id);
+        if (sinks.size() / 2 > UINT32_MAX || names.size() > UINT32_MAX)
+        {
+            cout << "[error] function(write_netlist_bin) netlist is too large for version " << NETLIST_BIN_VERSION << endl;
+            exit(1);
+        }
+        sink_off.push_back(sinks.size() / 2);
+        name_off.push_back(names.size());
+    }
+
+    Netlist_bin_header header;
+    memcpy(header.magic, netlist_bin_magic, 8);
+    header.version = NETLIST_BIN_VERSION;
+    header.link_num = links.size() / 3;
+    header.net_num = net.size();
+    header.sink_num = sinks.size() / 2;
+    header.name_bytes = names.size();
+
+    ofstream fout(file, ios::binary);
+    fout.write((const char *)&header, sizeof(header));
+    fout.write((const char *)sink_off.data(), sink_off.size() * sizeof(uint32_t));
+    fout.write((const char *)name_off.data(), name_off.size() * sizeof(uint32_t));
+    fout.write((const char *)links.data(), links.size() * sizeof(int32_t));
+    fout.write((const char *)source.data(), source.size() * sizeof(int32_t));
+    fout.write((const char *)sinks.data(), sinks.size() * sizeof(int32_t));
+    fout.write(names.data(), names.size());
+    fout.close();
+
+    if (!fout)
+    {
+        cout << "[error] function(write_netlist_bin) cannot write " << file << endl;
+        exit(1);
+    }
+}
+
+void FPGA_Gr::getfile_bin(const char *file)
+{
+    int fd = open(file, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Netlist_bin_header))
+    {
+        cout << "[error] function(getfile_bin) cannot open " << file << endl;
+        exit(1);
+    }
+
+    size_t size = st.st_size;
+    const char *data = (const char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        cout << "[error] function(getfile_bin) cannot map " << file << endl;
+        exit(1);
+    }
+
+    const Netlist_bin_header *header = (const Netlist_bin_header *)data;
+    if (memcmp(header->magic, netlist_bin_magic, 8) != 0 || header->version != NETLIST_BIN_VERSION)
+    {
+        cout << "[error] function(getfile_bin) " << file << " is not a netlist of version " << NETLIST_BIN_VERSION << endl;
+        exit(1);
+    }
+
+    //every section must fit in the rest of the file before it is used (counts are checked one by one to avoid overflow)
+    const auto bad_file = [&]() {
+        cout << "[error] function(getfile_bin) " << file << " is truncated or corrupted" << endl;
+        exit(1);
+    };
+    size_t remain = size - sizeof(Netlist_bin_header);
+    const auto take_section = [&](const uint64_t &count, const size_t &elem) {
+        if (count > remain / elem)
+            bad_file();
+        remain -= count * elem;
+    };
+    if (header->net_num >= UINT32_MAX)
+        bad_file();
+    take_section(header->net_num + 1, sizeof(uint32_t) * 2); //sink_off, name_off
+    take_section(header->link_num, sizeof(int32_t) * 3);
+    take_section(header->net_num, sizeof(int32_t));
+    take_section(header->sink_num, sizeof(int32_t) * 2);
+    take_section(header->name_bytes, 1);
+    if (remain != 0)
+        bad_file();
+
+    const size_t net_num = header->net_num;
+    const uint32_t *sink_off = (const uint32_t *)(header + 1);
+    const uint32_t *name_off = sink_off + net_num + 1;
+    const int32_t *links = (const int32_t *)(name_off + net_num + 1);
+    const int32_t *source = links + 3 * header->link_num;
+    const int32_t *sinks = source + net_num;
+    const char *names = (const char *)(sinks + 2 * header->sink_num);
+
+    //net offsets must run from 0 to the section size without going back
+    if (sink_off[0] != 0 || name_off[0] != 0 || sink_off[net_num] != header->sink_num || name_off[net_num] != header->name_bytes)
+        bad_file();
+    for (size_t id = 0; id < net_num; id++)
+    {
+        if (sink_off[id] > sink_off[id + 1] || name_off[id] > name_off[id + 1])
+            bad_file();
+    }
+    if (header->link_num == 0)
+        bad_file();
+
+    vector<int> fpgas(header->link_num), fpga_nbr(header->link_num), pair(header->link_num);
+    for (size_t i = 0; i < header->link_num; i++)
+    {
+        fpgas[i] = links[3 * i];
+        fpga_nbr[i] = links[3 * i + 1];
+        pair[i] = links[3 * i + 2];
+        if (fpgas[i] < 0 || fpga_nbr[i] < 0)
+            bad_file();
+    }
+    build_topology(fpgas, fpga_nbr, pair);
+
+    //nets are independent, fill them in blocks
+    const int block = 1 << 16;
+    const int block_num = (net_num + block - 1) / block;
+    vector<double> block_weight(block_num, 0.0);
+    net.resize(net_num);
+
+    parallel_for(block_num, thread_num, [&](const int &b) {
+        for (size_t id = (size_t)b * block; id < std::min(net_num, (size_t)(b + 1) * block); id++)
+        {
+            Net &n = net[id];
+            n.id = id;
+            n.name_id = id;
+            n.source = source[id] < 0 ? -1 : fpga_index(source[id]);
+            n.sink.resize(sink_off[id + 1] - sink_off[id]);
+            for (size_t k = sink_off[id]; k < sink_off[id + 1]; k++)
+            {
+                Sink &sk = n.sink[k - sink_off[id]];
+                sk.id = fpga_index(sinks[2 * k]);
+                sk.weight = sinks[2 * k + 1];
+                n.total_sink_weight += sk.weight;
+            }
+            block_weight[b] += n.total_sink_weight;
+        }
+    });
+
+    double total_sink_weight = 0.0;
+    for (const auto &w : block_weight)
+        total_sink_weight += w;
+    sink_num += header->sink_num;
+
+    //names are already stored back to back
+    net_name.data.assign(names, header->name_bytes);
+    net_name.off.assign(name_off, name_off + net_num + 1);
+
+    munmap((void *)data, size);
+    finish_netlist(total_sink_weight);
+}
+
+int FPGA_Gr::fpga_index(const int &code) //return fpga id of 100 * U + 10 * M + F
+{
+    if (code < 0 || code >= (int)code_to_id.size() || code_to_id[code] < 0)
+    {
+        cout << "[error] function(fpga_index) FPGA " << code << " is not in the system file !" << endl;
+        exit(1);
+    }
+
+    return code_to_id[code];
+}
+
+int FPGA_Gr::edge_index(const int &s, const int &t) //return edge id of channel s<-->t
+{
+    int k = graph.find(s, t);
+
+    if (k < 0)
+    {
+        cout << "[error] function(edge_index) " << fpga[s].name() << " and " << fpga[t].name() << " are not adjacent !" << endl;
+        exit(1);
+    }
+
+    return graph.edge[k];
+}
+
+Channel *FPGA_Gr::get_channel(const pair<int, int> &ch_name) //return channel of adjacent fpga pair
+{
+    return channel[edge_index(ch_name.first, ch_name.second)];
+}
+
+int FPGA_Gr::direct_index(const int &s, const int &t) //return edge id * 2 + direct of channel s-->t
+{
+    return 2 * edge_index(s, t) + ((s < t) ? 0 : 1);
 }
 
 void FPGA_Gr::output_file(char *outfile, time_t t)
@@ -384,6 +1067,27 @@ void FPGA_Gr::breakdown()
 {
     for (auto &n : net)
     {
+        //terminal lookup for cost evaluation, a repeated sink keeps its last weight
+        //(and its first weight for the routing tree, see compute_edge_weight)
+        n.sink_lut.clear();
+        n.sink_first.clear();
+        for (const auto &sk : n.sink)
+            n.sink_lut.push_back(make_pair(sk.id, sk.weight));
+        stable_sort(n.sink_lut.begin(), n.sink_lut.end(), comp_by_first);
+
+        size_t lut_size = 0;
+        for (size_t i = 0; i < n.sink_lut.size(); i++)
+        {
+            if (lut_size > 0 && n.sink_lut[lut_size - 1].first == n.sink_lut[i].first)
+                n.sink_lut[lut_size - 1].second = n.sink_lut[i].second;
+            else
+            {
+                n.sink_first.push_back(n.sink_lut[i].second);
+                n.sink_lut[lut_size++] = n.sink_lut[i];
+            }
+        }
+        n.sink_lut.resize(lut_size);
+
         const int &source = n.source;
         for (auto &sink : n.sink)
         {
@@ -400,7 +1104,7 @@ void FPGA_Gr::breakdown()
     /*
     for (auto &n : net)
     {
-        //cout << n.name << endl;
+        //cout << net_name.get(n.name_id) << endl;
         for (auto &sbn : n.sbnet)
         {
             //cout << "   " << sbn.source << " " << sbn.sink << ", weight = " << sbn.weight << endl;
@@ -411,319 +1115,473 @@ void FPGA_Gr::breakdown()
 
 void FPGA_Gr::construct_table_ver2()
 {
-    //resize path table
-    path_table_ver2.resize(fpga_num);
-    for (auto &pt : path_table_ver2)
-        pt.resize(fpga_num);
+    //parents are stored as uint16
+    if (fpga_num > 65536)
+    {
+        cout << "[error] construct_table_ver2() too many fpgas : " << fpga_num << endl;
+        exit(1);
+    }
+    path_table_ver2.n = fpga_num;
 
-    int k = LIMIT_HOP;     //限制最多超過min_hop k
-    int sol_num_limit = 5; //最多存幾條路徑
+    if (lazy_table)
+    {
+        //nothing is searched now, rows are searched when the router first asks for them
+        path_table_ver2.set_lazy(this, fpga_num);
+    }
+    else
+    {
+        //reuse the table of the same topology from cache
+        uint64_t key = table_cache_key(table_hop_limit, table_sol_limit);
+        string cache_file;
+        bool cached = false;
+        struct stat st;
+        if (!table_cache_dir.empty() && stat(table_cache_dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+        {
+            char key_str[20];
+            snprintf(key_str, sizeof(key_str), "%016llx", (unsigned long long)key);
+            cache_file = table_cache_dir + "/path_table_" + key_str + ".bin";
+            cached = load_table_cache(cache_file, key);
+        }
 
-    for (int i = 0; i < fpga_num; i++)
+        if (!cached)
+        {
+            build_min_hop();
+            build_path_table();
+            vector<int>().swap(min_hop); //only the search needs min hops
+            if (!cache_file.empty())
+                save_table_cache(cache_file, key);
+        }
+    }
+
+    //construct channel table (only physically adjacent fpgas)
+    channel.resize(edge_num);
+    for (int e = 0; e < edge_num; e++)
+    {
+        Channel *ch = new Channel();
+        ch->name = edge_name[e];
+        channel[e] = ch;
+    }
+
+    //record capacity and initial channel state
+    edge_capacity.assign(edge_num, 0);
+    for (size_t k = 0; k < graph.nbr.size(); k++)
+    {
+        //edge_capacity[graph.edge[k]] = graph.pairs[k];
+        edge_capacity[graph.edge[k]] = capacity;
+    }
+
+    channel_demand.assign(2 * edge_num, 0);
+    channel_capacity.assign(2 * edge_num, 0);
+    history_used.assign(2 * edge_num, 0.0);
+    history_cost.assign(2 * edge_num, 0.0);
+    history_penalty.assign(2 * edge_num, 1.0);
+    congestion_map.assign(edge_num, 0);
+    congestion_used.assign(edge_num, false);
+    old_map_vec.assign(edge_num, 0);
+    RRtimes.assign(edge_num, 0);
+
+    /*
+    for (int e = 0; e < edge_num; e++)
     {
-        queue<vector<int>> init_queue;
-        queue<vector<int>> path_queue;
+        cout << "channel (" << edge_name[e].first << ", " << edge_name[e].second << ") : " << endl;
+        cout << "capacity = " << edge_capacity[e] << endl;
+        cout << endl;
+    }
+    */
 
-        for (const auto &nbr : fpga[i].nbr_pair)
+    //show_path_table_ver2();
+}
+
+void FPGA_Gr::build_min_hop()
+{
+    //all pairs min hops (one BFS per source, rows are independent)
+    min_hop.assign(fpga_num * fpga_num, -1);
+
+    parallel_for(fpga_num, thread_num, [&](const int &i) {
+        vector<int> bfs_queue(fpga_num);
+        bfs_min_hop(i, &min_hop[i * fpga_num], bfs_queue);
+    });
+}
+
+void FPGA_Gr::bfs_min_hop(const int &s, int *dist, vector<int> &bfs_queue)
+{
+    //min hops of every fpga from s, dist must be filled with -1 and bfs_queue hold fpga_num ids
+    int head = 0, tail = 0;
+    dist[s] = 0;
+    bfs_queue[tail++] = s;
+
+    while (head < tail)
+    {
+        const int cur = bfs_queue[head++];
+        for (int e = graph.offset[cur]; e < graph.offset[cur + 1]; e++)
         {
-            const int &nbr_fpga = nbr.first;
-            vector<int> init_path;
-            init_path.push_back(i);
-            init_path.push_back(nbr_fpga);
-            init_queue.push(init_path);
+            const int &nbr_id = graph.nbr[e];
+            if (dist[nbr_id] < 0)
+            {
+                dist[nbr_id] = dist[cur] + 1;
+                bfs_queue[tail++] = nbr_id;
+            }
         }
+    }
+}
+
+void FPGA_Gr::build_path_table()
+{
+    //source i only writes the pairs (i, j > i), so the table is identical to the sequential one whatever the thread schedule is
+    table_build.assign(path_table_ver2.cell_num(), Table_build_cell());
+
+    parallel_for(fpga_num, thread_num, [&](const int &i) {
+        vector<int> path;
+        vector<char> visited(fpga_num, 0);
 
-        //search fpga_i to fpga_j min ~ min + k hops
         for (int j = i + 1; j < fpga_num; j++)
         {
-            vector<vector<int>> path_sol;
-            path_queue = init_queue;
-            int min_hop = INT_MAX;
-            int path_sol_num = 0;
-            //cout << "search F" << i << " to F" << j << " paths..." << endl;
+            search_table_pair(i, j, &min_hop[(size_t)j * fpga_num], path, visited, table_build[path_table_ver2.cell_index(i, j)]);
+        }
+    });
 
-            while (!path_queue.empty())
-            {
-                bool find = false;
-                auto cur_path = path_queue.front();
-                path_queue.pop();
+    pack_path_table();
+}
 
-                if (cur_path.size() - 1 > min_hop + k)
-                {
-                    continue;
-                }
+shared_ptr<const Table_row> FPGA_Gr::build_table_row(const int &s)
+{
+    //candidates of s to every sink, pair (i, j) (i < j) is searched from i with the min hops to j as in build_path_table,
+    //so a row holds the same candidates as the whole table
+    auto row = make_shared<Table_row>();
+    row->cell_off.assign(fpga_num + 1, 0);
 
-                const int &cur_fpga = cur_path.back();
+    const auto dist_s = path_table_ver2.get_dist(s);
+    vector<int> path;
+    vector<char> visited(fpga_num, 0);
+    Table_build_cell cell;
 
-                if (cur_fpga == j) //find target
-                {
-                    find = true;
-                    path_sol_num++;
+    for (int t = 0; t < fpga_num; t++)
+    {
+        row->cell_off[t] = row->rec.size();
+        if (t == s)
+            continue;
 
-                    if (cur_path.size() - 1 < min_hop)
-                    {
-                        min_hop = cur_path.size() - 1;
-                    }
+        cell.clear();
+        if (t < s)
+            search_table_pair(t, s, dist_s->hops.data(), path, visited, cell);
+        else
+            search_table_pair(s, t, path_table_ver2.get_dist(t)->hops.data(), path, visited, cell);
 
-                    //存入path table
-                    const int &start = cur_path[0];
+        for (const auto &tc : cell)
+        {
+            const auto &parent = (t < s) ? tc.rev_parent : tc.parent; //node before t on s --> t
+
+            Table_record rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.hops = tc.hops;
+            rec.par_num = parent.size();
+            rec.par_begin = row->par.size();
+            row->rec.push_back(rec);
+            row->par.insert(row->par.end(), parent.begin(), parent.end());
+        }
+    }
+    row->cell_off[fpga_num] = row->rec.size();
 
-                    bool flag1 = false; //看看是否已有相同hop數的解
-                    bool flag2 = false;
+    return row;
+}
 
-                    for (auto &pt : path_table_ver2[i][j].cand)
-                    {
-                        if (pt.hops == cur_path.size() - 1)
-                        {
-                            flag1 = true;
-                            const int &par = cur_path[cur_path.size() - 2];
+shared_ptr<const Dist_row> FPGA_Gr::build_dist_row(const int &t)
+{
+    //min hops of every fpga to t (the graph is undirected)
+    auto row = make_shared<Dist_row>();
+    row->hops.assign(fpga_num, -1);
+    vector<int> bfs_queue(fpga_num);
+    bfs_min_hop(t, row->hops.data(), bfs_queue);
 
-                            bool isAdded = false;
-                            for (const auto &added : pt.parent)
-                            {
-                                if (added == par)
-                                {
-                                    isAdded = true;
-                                    break;
-                                }
-                            }
+    return row;
+}
 
-                            if (!isAdded)
-                            {
-                                pt.parent.push_back(par);
-                            }
+void FPGA_Gr::search_table_pair(const int &i, const int &j, const int *dist_j, vector<int> &path, vector<char> &visited, Table_build_cell &cell)
+{
+    //search fpga_i to fpga_j min ~ min + k hops, dist_j : min hops of every fpga to fpga_j (-1 : unreachable)
+    //paths are visited level by level in the same order as a BFS over all simple paths,
+    //so the first sol_num_limit + 1 solutions are the same ones that BFS would find
+    const int &k = table_hop_limit;          //限制最多超過min_hop k
+    const int &sol_num_limit = table_sol_limit; //最多存幾條路徑
+    const int &min = dist_j[i];
+    if (min < 0) //unreachable
+        return;
 
-                            break;
-                        }
-                    }
+    int sol_num = 0;
+    path.assign(1, i);
+    visited[i] = 1;
 
-                    for (auto &pt : path_table_ver2[j][i].cand)
-                    {
-                        if (pt.hops == cur_path.size() - 1)
-                        {
-                            flag2 = true;
-                            const int &par = cur_path[1];
+    //level l expands paths of l hops and finds solutions of l + 1 hops (and the direct one at level 1)
+    for (int len = std::max(min, 2); len <= min + k + 1 && sol_num <= sol_num_limit; len++)
+    {
+        search_table_path(path, visited, j, dist_j, len, sol_num, cell);
+    }
+    visited[i] = 0;
 
-                            bool isAdded = false;
-                            for (const auto &added : pt.parent)
-                            {
-                                if (added == par)
-                                {
-                                    isAdded = true;
-                                    break;
-                                }
-                            }
+    //sort all candidate path by hops
+    sort(cell.begin(), cell.end(), comp_hops);
+}
 
-                            if (!isAdded)
-                            {
-                                pt.parent.push_back(par);
-                            }
-                            break;
-                        }
-                    }
+void FPGA_Gr::search_table_path(vector<int> &path, vector<char> &visited, const int &t, const int *dist_t, const int &len, int &sol_num, Table_build_cell &cell)
+{
+    //extend path to t with exactly len hops, candidates which cannot reach t in time are pruned by min hop
+    const int cur = path.back();
+    const int hops = path.size() - 1;
 
-                    if (flag1 == false)
-                    {
-                        Table_content temp;
-                        temp.hops = cur_path.size() - 1;
-                        temp.parent.push_back(cur_path[cur_path.size() - 2]);
-                        path_table_ver2[i][j].cand.push_back(temp);
-                    }
+    if (hops + 1 == len)
+    {
+        if (dist_t[cur] == 1)
+        {
+            path.push_back(t);
+            record_table_path(path, cell);
+            path.pop_back();
+            sol_num++;
+        }
+        return;
+    }
 
-                    if (flag2 == false)
-                    {
-                        Table_content temp;
-                        temp.hops = cur_path.size() - 1;
-                        temp.parent.push_back(cur_path[1]);
-                        path_table_ver2[j][i].cand.push_back(temp);
-                    }
-                }
+    for (int e = graph.offset[cur]; e < graph.offset[cur + 1] && sol_num <= table_sol_limit; e++)
+    {
+        const int &nbr_id = graph.nbr[e];
 
-                if (path_sol_num > sol_num_limit)
-                {
-                    break;
-                }
+        if (nbr_id == t)
+        {
+            if (hops == 0 && len == 2) //direct path is found together with 2 hops paths
+            {
+                path.push_back(t);
+                record_table_path(path, cell);
+                path.pop_back();
+                sol_num++;
+            }
+            continue;
+        }
+
+        if (visited[nbr_id] == 1 || dist_t[nbr_id] < 0 || hops + 1 + dist_t[nbr_id] > len)
+            continue;
 
-                if (!find)
-                {
-                    vector<int> visited(fpga_num, 0);
-                    for (const auto &fid : cur_path)
-                    {
-                        visited[fid] = 1;
-                    }
+        visited[nbr_id] = 1;
+        path.push_back(nbr_id);
+        search_table_path(path, visited, t, dist_t, len, sol_num, cell);
+        path.pop_back();
+        visited[nbr_id] = 0;
+    }
+}
 
-                    //往下走一步
-                    for (const auto &nbr : fpga[cur_fpga].nbr_pair)
-                    {
-                        if (visited[nbr.first] == 0)
-                        {
-                            auto temp_path = cur_path;
-                            temp_path.push_back(nbr.first);
+void FPGA_Gr::record_table_path(const vector<int> &path, Table_build_cell &cell)
+{
+    //存入path table (s-->t and t-->s)
+    const int hops = path.size() - 1;
 
-                            if (nbr.first == j) //確認是否find target
-                            {
-                                find = true;
-                                path_sol_num++;
+    add_table_content(cell, hops, path[hops - 1], path[1]);
+}
 
-                                if (temp_path.size() - 1 < min_hop)
-                                {
-                                    min_hop = temp_path.size() - 1;
-                                }
+void Path_Table::set_lazy(FPGA_Gr *gr, const int &fpga_num)
+{
+    n = fpga_num;
+    lazy = true;
+    owner = gr;
+    //a min hops row is small next to a candidate row
+    row_cache.init(n, mem_limit - mem_limit / 8);
+    dist_cache.init(n, mem_limit / 8);
+}
 
-                                //存入path table
-                                const int &start = temp_path[0];
+shared_ptr<const Table_row> Path_Table::get_row(const int &s) const
+{
+    auto row = row_cache.find(s);
+    if (row)
+        return row;
 
-                                bool flag1 = false; //看看是否已有相同hop數的解
-                                bool flag2 = false;
+    //search outside the lock, if another thread finished the same row first its copy is used
+    return row_cache.insert(s, owner->build_table_row(s));
+}
 
-                                for (auto &pt : path_table_ver2[i][j].cand)
-                                {
-                                    if (pt.hops == temp_path.size() - 1)
-                                    {
-                                        flag1 = true;
-                                        const int &par = temp_path[temp_path.size() - 2];
-
-                                        bool isAdded = false;
-                                        for (const auto &added : pt.parent)
-                                        {
-                                            if (added == par)
-                                            {
-                                                isAdded = true;
-                                                break;
-                                            }
-                                        }
-
-                                        if (!isAdded)
-                                        {
-                                            pt.parent.push_back(par);
-                                        }
-
-                                        break;
-                                    }
-                                }
+shared_ptr<const Dist_row> Path_Table::get_dist(const int &t) const
+{
+    auto row = dist_cache.find(t);
+    if (row)
+        return row;
 
-                                for (auto &pt : path_table_ver2[j][i].cand)
-                                {
-                                    if (pt.hops == temp_path.size() - 1)
-                                    {
-                                        flag2 = true;
-                                        const int &par = temp_path[1];
-
-                                        bool isAdded = false;
-                                        for (const auto &added : pt.parent)
-                                        {
-                                            if (added == par)
-                                            {
-                                                isAdded = true;
-                                                break;
-                                            }
-                                        }
-
-                                        if (!isAdded)
-                                        {
-                                            pt.parent.push_back(par);
-                                        }
-                                        break;
-                                    }
-                                }
+    return dist_cache.insert(t, owner->build_dist_row(t));
+}
 
-                                if (flag1 == false)
-                                {
-                                    Table_content temp;
-                                    temp.hops = temp_path.size() - 1;
-                                    temp.parent.push_back(temp_path[temp_path.size() - 2]);
-                                    path_table_ver2[i][j].cand.push_back(temp);
-                                }
+void FPGA_Gr::pack_path_table()
+{
+    //move candidates of table_build into the flat path table
+    auto &pt = path_table_ver2;
+    const size_t cell_num = table_build.size();
+    pt.cell_off.assign(cell_num + 1, 0);
 
-                                if (flag2 == false)
-                                {
-                                    Table_content temp;
-                                    temp.hops = temp_path.size() - 1;
-                                    temp.parent.push_back(temp_path[1]);
-                                    path_table_ver2[j][i].cand.push_back(temp);
-                                }
-                            }
-                            else //not find target
-                            {
-                                path_queue.push(temp_path);
-                            }
-                        }
-                    }
-                }
-            }
-        }
+    size_t rec_num = 0, par_num = 0;
+    for (size_t cell = 0; cell < cell_num; cell++)
+    {
+        pt.cell_off[cell] = rec_num;
+        rec_num += table_build[cell].size();
+        for (const auto &tc : table_build[cell])
+            par_num += tc.parent.size() + tc.rev_parent.size();
     }
+    pt.cell_off[cell_num] = rec_num;
 
-    //sort all candidate path by hops
-    for (int i = 0; i < fpga_num; i++)
+    pt.rec.clear();
+    pt.rec.reserve(rec_num);
+    pt.par.clear();
+    pt.par.reserve(par_num);
+    for (auto &cell : table_build)
     {
-        for (int j = 0; j < fpga_num; j++)
+        for (const auto &tc : cell)
         {
-            if (i != j)
-                sort(path_table_ver2[i][j].cand.begin(), path_table_ver2[i][j].cand.end(), comp_hops);
+            Table_record rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.hops = tc.hops;
+            rec.par_num = tc.parent.size();
+            rec.rev_num = tc.rev_parent.size();
+            rec.par_begin = pt.par.size();
+            pt.rec.push_back(rec);
+            pt.par.insert(pt.par.end(), tc.parent.begin(), tc.parent.end());
+            pt.par.insert(pt.par.end(), tc.rev_parent.begin(), tc.rev_parent.end());
         }
+        Table_build_cell().swap(cell);
     }
 
-    //construct channel table
-    for (size_t i = 0; i < fpga.size(); i++)
-    {
-        for (size_t j = i + 1; j < fpga.size(); j++)
+    vector<Table_build_cell>().swap(table_build);
+}
+
+uint64_t FPGA_Gr::table_cache_key(const int &k, const int &sol_num_limit)
+{
+    //FNV-1a over table settings and topology
+    uint64_t key = 14695981039346656037ULL;
+    auto mix = [&key](const int &v) {
+        for (int b = 0; b < 4; b++)
         {
-            pair<int, int> chan = make_pair(i, j);
-            Channel *ch = new Channel();
-            ch->name = chan;
-            map_to_channel[chan] = ch;
+            key ^= (v >> (8 * b)) & 0xff;
+            key *= 1099511628211ULL;
         }
-    }
+    };
+
+    mix(TABLE_CACHE_VERSION);
+    mix(k);
+    mix(sol_num_limit);
+    mix(fpga_num);
+    for (const auto &f : fpga)
+        mix(f.code);
+    for (const auto &o : graph.offset)
+        mix(o);
+    for (const auto &v : graph.nbr)
+        mix(v);
+
+    return key;
+}
 
-    //record capacity
-    for (int i = 0; i < fpga_num; i++)
+//layout : header, cell_off[n * (n - 1) / 2 + 1], rec[rec_num], par[par_num] (same as Path_Table)
+struct Table_cache_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t fpga_num;
+    uint64_t key;
+    uint64_t rec_num;
+    uint64_t par_num;
+};
+
+static const char table_cache_magic[8] = {'F', 'P', 'G', 'A', 'P', 'T', 'A', 'B'};
+
+bool FPGA_Gr::load_table_cache(const string &file, const uint64_t &key)
+{
+    //a missing, stale or corrupted cache is treated as no cache, the table is then built again
+    ifstream fin(file, ios::binary);
+    if (!fin)
+        return false;
+
+    Table_cache_header header;
+    if (!fin.read((char *)&header, sizeof(header)))
+        return false;
+
+    fin.seekg(0, ios::end);
+    const size_t size = fin.tellg();
+    fin.seekg(sizeof(header));
+
+    const size_t cell_num = path_table_ver2.cell_num();
+    if (memcmp(header.magic, table_cache_magic, 8) != 0 || header.version != TABLE_CACHE_VERSION ||
+        header.fpga_num != (uint32_t)fpga_num || header.key != key ||
+        header.rec_num > UINT32_MAX || header.par_num > UINT32_MAX ||
+        size != sizeof(Table_cache_header) + sizeof(uint32_t) * (cell_num + 1) +
+                    sizeof(Table_record) * header.rec_num + sizeof(uint16_t) * header.par_num)
+        return false;
+
+    //read straight into the table, no second copy of the file is kept
+    auto &pt = path_table_ver2;
+    pt.cell_off.resize(cell_num + 1);
+    pt.rec.resize(header.rec_num);
+    pt.par.resize(header.par_num);
+    fin.read((char *)pt.cell_off.data(), pt.cell_off.size() * sizeof(uint32_t));
+    fin.read((char *)pt.rec.data(), pt.rec.size() * sizeof(Table_record));
+    fin.read((char *)pt.par.data(), pt.par.size() * sizeof(uint16_t));
+
+    //every record and parent must stay inside the table
+    bool valid = (bool)fin && pt.cell_off[0] == 0 && pt.cell_off[cell_num] == header.rec_num;
+    for (size_t cell = 0; valid && cell < cell_num; cell++)
+        valid = pt.cell_off[cell] <= pt.cell_off[cell + 1];
+    for (size_t r = 0; valid && r < pt.rec.size(); r++)
+        valid = (uint64_t)pt.rec[r].par_begin + pt.rec[r].par_num + pt.rec[r].rev_num <= header.par_num;
+    for (size_t k = 0; valid && k < pt.par.size(); k++)
+        valid = pt.par[k] < fpga_num;
+
+    if (!valid)
     {
-        for (size_t j = 0; j < fpga[i].nbr_pair.size(); j++)
-        {
-            int nbr_id = fpga[i].nbr_pair[j].first;
-            auto ch_name = get_channel_name(i, nbr_id);
-            auto ch = map_to_channel[ch_name];
-            //ch->capacity = fpga[i].nbr_pair[j].second;
-            ch->capacity = capacity;
-        }
+        vector<uint32_t>().swap(pt.cell_off);
+        vector<Table_record>().swap(pt.rec);
+        vector<uint16_t>().swap(pt.par);
     }
+    return valid;
+}
 
-    /*
-    for (const auto &ch:map_to_channel)
+void FPGA_Gr::save_table_cache(const string &file, const uint64_t &key)
+{
+    const auto &pt = path_table_ver2;
+
+    Table_cache_header header;
+    memcpy(header.magic, table_cache_magic, 8);
+    header.version = TABLE_CACHE_VERSION;
+    header.fpga_num = fpga_num;
+    header.key = key;
+    header.rec_num = pt.rec.size();
+    header.par_num = pt.par.size();
+
+    //write to a temporary file first so other runs never read a half written table
+    string tmp_file = file + ".tmp" + to_string(getpid());
+    ofstream fout(tmp_file, ios::binary);
+    fout.write((const char *)&header, sizeof(header));
+    fout.write((const char *)pt.cell_off.data(), pt.cell_off.size() * sizeof(uint32_t));
+    fout.write((const char *)pt.rec.data(), pt.rec.size() * sizeof(Table_record));
+    fout.write((const char *)pt.par.data(), pt.par.size() * sizeof(uint16_t));
+    fout.close();
+
+    if (!fout || rename(tmp_file.c_str(), file.c_str()) != 0)
     {
-        if(ch.second->capacity == 0)
-            continue;
-        
-        cout << "channel (" << ch.first.first << ", " << ch.first.second << ") : " << endl;
-        cout << "capacity = " << ch.second->capacity << endl;
-        cout << endl;
+        remove(tmp_file.c_str());
+        cout << "[warning] save_table_cache(" << file << ") failed" << endl;
     }
-    */
-
-    cout << "OK" << endl;
-    //show_path_table_ver2();
 }
 
 void FPGA_Gr::show_path_table_ver2()
 {
     for (int i = 0; i < fpga_num; i++)
     {
+        const auto pt_row = path_table_ver2[i];
         for (int j = 0; j < fpga_num; j++)
         {
             if (i == j)
                 continue;
 
-            cout << "F" << i << " to "
-                 << "F" << j << " : " << endl;
+            cout << fpga[i].name() << " to "
+                 << fpga[j].name() << " : " << endl;
 
-            for (const auto &pt2 : path_table_ver2[i][j].cand)
+            for (const auto &pt2 : pt_row[j].cand)
             {
                 cout << "hops = " << pt2.hops << endl;
                 cout << "parents : ";
                 for (const auto &par : pt2.parent)
                 {
-                    cout << par << " ";
+                    cout << fpga[par].name() << " ";
                 }
                 cout << "\n";
             }
@@ -734,25 +1592,26 @@ void FPGA_Gr::show_path_table_ver2()
 
 void FPGA_Gr::add_channel_demand(const int &s, const int &t)
 {
-    auto ch_name = get_channel_name(s, t);
-    auto ch = map_to_channel[ch_name];
-    int ch_cap = ch->capacity;
-    double dir_0 = ++channel_demand[make_pair(s, t)];
-    double dir_1 = channel_demand[make_pair(t, s)];
+    const int e = edge_index(s, t);
+    const int idx_0 = 2 * e + ((s < t) ? 0 : 1); //s-->t
+    const int idx_1 = 2 * e + ((s < t) ? 1 : 0); //t-->s
+    int ch_cap = edge_capacity[e];
+    double dir_0 = ++channel_demand[idx_0];
+    double dir_1 = channel_demand[idx_1];
     double total = dir_0 + dir_1;
-    int cap_0 = channel_capacity[make_pair(s, t)] = (double)ch_cap * (dir_0 / total);
-    int cap_1 = channel_capacity[make_pair(t, s)] = ch_cap - cap_0;
+    int cap_0 = channel_capacity[idx_0] = (double)ch_cap * (dir_0 / total);
+    int cap_1 = channel_capacity[idx_1] = ch_cap - cap_0;
 
     if (cap_0 == 0 && dir_0 != 0)
     {
-        channel_capacity[make_pair(s, t)]++;
-        channel_capacity[make_pair(t, s)]--;
+        channel_capacity[idx_0]++;
+        channel_capacity[idx_1]--;
     }
 
     if (cap_1 == 0 && dir_1 != 0)
     {
-        channel_capacity[make_pair(s, t)]--;
-        channel_capacity[make_pair(t, s)]++;
+        channel_capacity[idx_0]--;
+        channel_capacity[idx_1]++;
     }
 
     total_demand++;
@@ -760,25 +1619,26 @@ void FPGA_Gr::add_channel_demand(const int &s, const int &t)
 
 void FPGA_Gr::sub_channel_demand(const int &s, const int &t)
 {
-    auto ch_name = get_channel_name(s, t);
-    auto ch = map_to_channel[ch_name];
-    int ch_cap = ch->capacity;
-    double dir_0 = --channel_demand[make_pair(s, t)];
-    double dir_1 = channel_demand[make_pair(t, s)];
+    const int e = edge_index(s, t);
+    const int idx_0 = 2 * e + ((s < t) ? 0 : 1); //s-->t
+    const int idx_1 = 2 * e + ((s < t) ? 1 : 0); //t-->s
+    int ch_cap = edge_capacity[e];
+    double dir_0 = --channel_demand[idx_0];
+    double dir_1 = channel_demand[idx_1];
     double total = dir_0 + dir_1;
-    int cap_0 = channel_capacity[make_pair(s, t)] = (double)ch_cap * (dir_0 / total);
-    int cap_1 = channel_capacity[make_pair(t, s)] = ch_cap - cap_0;
+    int cap_0 = channel_capacity[idx_0] = (double)ch_cap * (dir_0 / total);
+    int cap_1 = channel_capacity[idx_1] = ch_cap - cap_0;
 
     if (cap_0 == 0 && dir_0 != 0)
     {
-        channel_capacity[make_pair(s, t)]++;
-        channel_capacity[make_pair(t, s)]--;
+        channel_capacity[idx_0]++;
+        channel_capacity[idx_1]--;
     }
 
     if (cap_1 == 0 && dir_1 != 0)
     {
-        channel_capacity[make_pair(s, t)]--;
-        channel_capacity[make_pair(t, s)]++;
+        channel_capacity[idx_0]--;
+        channel_capacity[idx_1]++;
     }
 
     total_demand--;
@@ -786,7 +1646,7 @@ void FPGA_Gr::sub_channel_demand(const int &s, const int &t)
 
 int FPGA_Gr::ret_channel_capacity(const int &s, const int &t)
 {
-    return channel_capacity[make_pair(s, t)];
+    return channel_capacity[direct_index(s, t)];
 }
 
 void FPGA_Gr::global_routing_ver2()
@@ -803,7 +1663,7 @@ void FPGA_Gr::global_routing_ver2()
 
     for (auto &n : net)
     {
-        //cout << n.name << " all subnets' paths" << endl;
+        //cout << net_name.get(n.name_id) << " all subnets' paths" << endl;
 
         map<pair<int, int>, int> edge_lut; //使用過的edge會加入這個map
 
@@ -826,12 +1686,13 @@ void FPGA_Gr::global_routing_ver2()
                 path.push_back(sb.sink);
                 sources.push_back(sb.sink);
 
-                int cand_hop_num = path_table_ver2[sb.source][sb.sink].cand.size();
+                const auto pt_row = path_table_ver2[sb.source];
+                int cand_hop_num = pt_row[sb.sink].cand.size();
                 //cout << "candidate hop number = " << cand_hop_num << endl;
                 //cout << "source = " << sb.source << ", sink = " << sb.sink << endl;
                 if (cand_hop_num == 1) //一般作法
                 {
-                    int min_hops = path_table_ver2[sb.source][sb.sink].cand[0].hops;
+                    int min_hops = pt_row[sb.sink].cand[0].hops;
 
                     if (min_hops == 1) //hops = 1 --> done !
                     {
@@ -852,7 +1713,7 @@ void FPGA_Gr::global_routing_ver2()
                     const int &sc = sb.source;
 
                     queue<vector<int>> path_queue;
-                    for (const auto &first_parent : path_table_ver2[sc][sb.sink].cand[0].parent)
+                    for (const auto &first_parent : pt_row[sb.sink].cand[0].parent)
                     {
                         vector<int> path;
                         path.push_back(sb.sink);
@@ -872,7 +1733,7 @@ void FPGA_Gr::global_routing_ver2()
                             continue;
                         }
 
-                        for (const auto &parent : path_table_ver2[sc][cur_path.back()].cand[0].parent)
+                        for (const auto &parent : pt_row[cur_path.back()].cand[0].parent)
                         {
                             auto temp_path = cur_path;
                             temp_path.push_back(parent);
@@ -918,7 +1779,7 @@ void FPGA_Gr::global_routing_ver2()
                     const int &sc = sb.source;
                     for (size_t i = 0; i <= hop_limit; i++)
                     {
-                        const auto &cur_cand = path_table_ver2[sb.source][sb.sink].cand[i];
+                        const auto &cur_cand = pt_row[sb.sink].cand[i];
                         int hop = cur_cand.hops;
 
                         //hop = 1 直接做
@@ -957,7 +1818,7 @@ void FPGA_Gr::global_routing_ver2()
                             int index, count = 0;
                             int cur_hop = cur_path.size() - 1;
                             int search_hop = hop - cur_hop;
-                            for (const auto &cand : path_table_ver2[sc][cur_path.back()].cand)
+                            for (const auto &cand : pt_row[cur_path.back()].cand)
                             {
                                 if (cand.hops == search_hop)
                                 {
@@ -967,7 +1828,7 @@ void FPGA_Gr::global_routing_ver2()
                                 count++;
                             }
 
-                            for (const auto &parent : path_table_ver2[sc][cur_path.back()].cand[index].parent)
+                            for (const auto &parent : pt_row[cur_path.back()].cand[index].parent)
                             {
                                 auto temp_path = cur_path;
                                 temp_path.push_back(parent);
@@ -1036,13 +1897,15 @@ void FPGA_Gr::global_routing_ver2()
 
             vector<int> src_candidate;     //all sources to sink candidate with minimum fhops
             vector<vector<int>> cand_path; //save all candidate path
+            vector<int> src_min(sources.size(), INT_MAX); //min hops of sources[k] to sink
             int min_hops = INT_MAX;
             //find minimum f_hops
             //cout << "find minimum f_hops...";
-            for (const auto &s : sources)
+            for (size_t k = 0; k < sources.size(); k++)
             {
-                int min = INT_MAX;
-                for (const auto &cand : path_table_ver2[s][sb.sink].cand)
+                const auto pt_row = path_table_ver2[sources[k]];
+                int &min = src_min[k];
+                for (const auto &cand : pt_row[sb.sink].cand)
                 {
                     if (cand.hops < min)
                     {
@@ -1056,13 +1919,12 @@ void FPGA_Gr::global_routing_ver2()
 
             //save all source candidate with min hops
             //cout << "add source to src_candidate : ";
-            for (const auto &s : sources)
+            for (size_t k = 0; k < sources.size(); k++)
             {
-                int min = path_table_ver2[s][sb.sink].cand[0].hops;
-                if (min == min_hops)
+                if (src_min[k] == min_hops)
                 {
                     //cout << s << " ";
-                    src_candidate.push_back(s);
+                    src_candidate.push_back(sources[k]);
                 }
             }
             //cout << endl;
@@ -1070,11 +1932,12 @@ void FPGA_Gr::global_routing_ver2()
             for (const auto &sc : src_candidate)
             {
                 //cout << "search source " << sc << "'s all solution..." << endl;
-                int cand_size = path_table_ver2[sc][sb.sink].cand.size();
+                const auto pt_row = path_table_ver2[sc];
+                int cand_size = pt_row[sb.sink].cand.size();
                 int constraint = (hop_limit + 1 > cand_size) ? cand_size - 1 : hop_limit;
                 for (size_t i = 0; i <= constraint; i++)
                 {
-                    const auto &cur_cand = path_table_ver2[sc][sb.sink].cand[i];
+                    const auto &cur_cand = pt_row[sb.sink].cand[i];
                     int hop = cur_cand.hops;
 
                     //hop = 1 直接做
@@ -1113,7 +1976,7 @@ void FPGA_Gr::global_routing_ver2()
                         int index, count = 0;
                         int cur_hop = cur_path.size() - 1;
                         int search_hop = hop - cur_hop;
-                        for (const auto &cand : path_table_ver2[sc][cur_path.back()].cand)
+                        for (const auto &cand : pt_row[cur_path.back()].cand)
                         {
                             if (cand.hops == search_hop)
                             {
@@ -1123,7 +1986,7 @@ void FPGA_Gr::global_routing_ver2()
                             count++;
                         }
 
-                        for (const auto &parent : path_table_ver2[sc][cur_path.back()].cand[index].parent)
+                        for (const auto &parent : pt_row[cur_path.back()].cand[index].parent)
                         {
                             auto temp_path = cur_path;
                             temp_path.push_back(parent);
@@ -1185,7 +2048,7 @@ void FPGA_Gr::global_routing_ver2()
     //show routing tree
     /*for (const auto &n : net)
     {
-        cout << n.name << " routing tree : " << endl;
+        cout << net_name.get(n.name_id) << " routing tree : " << endl;
         show_tree(n.rtree_root);
         cout << endl;
     }*/
@@ -1195,7 +2058,7 @@ void FPGA_Gr::global_routing_ver3()
 {
     subnetbased = true;
     int hop_limit = LIMIT_HOP; //最多嘗試與最小hop數差幾個hop的限制條件
-    vector<pair<SubNet, int>> subnet_order;
+    vector<SubNet_Ref> subnet_order;
     vector<vector<int>> *allpaths; //紀錄每個net的所有subpath
     map<pair<int, int>, int> *edge_lut;
     //vector<int> *sources;
@@ -1214,30 +2077,29 @@ void FPGA_Gr::global_routing_ver3()
     auto t1 = clock();
     for (auto &n : net)
     {
-        for (auto &sb : n.sbnet)
+        for (size_t i = 0; i < n.sbnet.size(); i++)
         {
-            pair<SubNet, int> temp;
-            const int &src = sb.source;
-            const int &sink = sb.sink;
-            const int &hops = path_table_ver2[src][sink].cand[0].hops;
-            int weight = sb.weight;
-            temp = make_pair(sb, weight);
+            SubNet_Ref temp;
+            temp.weight = n.sbnet[i].weight;
+            temp.net_id = n.id;
+            temp.sb_id = i;
             subnet_order.push_back(temp);
         }
     }
-    sort(subnet_order.begin(), subnet_order.end(), comp_sbnetcost);
+    sort_subnet_order(subnet_order);
     //cout << "sort time = " << fixed << setprecision(2) << (double)(clock() - t1) / (double)CLOCKS_PER_SEC << " seconds\n";
 
     double total_time = 0.0;
 
     //start to route subnet
     int sub_order = 0;
-    for (auto &sb : subnet_order)
+    for (const auto &order : subnet_order)
     {
         auto t2 = clock();
-        const auto &par_net_id = sb.first.parent_net;
-        int source = sb.first.source;
-        int sink = sb.first.sink;
+        const SubNet &sb = net[order.net_id].sbnet[order.sb_id];
+        const auto &par_net_id = sb.parent_net;
+        int source = sb.source;
+        int sink = sb.sink;
 
         net[par_net_id].total_order += sub_order;
         sub_order++;
@@ -1267,10 +2129,10 @@ void FPGA_Gr::global_routing_ver3()
         //cout << "current subnet (src, sink) = (" << source << ", " << sink << ")\n";
 
         //start to routing
-        vector<vector<int>> cand_path;
-        vector<int> src_candidate;
+        cand_buf.clear();
+        vector<int> &src_candidate = cand_buf.src_candidate;
+        src_candidate.clear();
         int cur_node = source;
-        queue<pair<vector<int>, int>> path_queue; //(path, 剩餘hop)
         int minimum_hop;
 
         if (sources[par_net_id].size() == 0)
@@ -1281,32 +2143,7 @@ void FPGA_Gr::global_routing_ver3()
         }
         else
         {
-            int min_hops = INT_MAX;
-            for (const auto &s : sources[par_net_id])
-            {
-                int min = INT_MAX;
-                for (const auto &cand : path_table_ver2[s.first][sink].cand)
-                {
-                    if (cand.hops < min)
-                    {
-                        min = cand.hops;
-                    }
-                }
-                const int &tmp = min;
-                if (tmp < min_hops && tmp != 0)
-                    min_hops = tmp;
-            }
-
-            for (const auto &s : sources[par_net_id])
-            {
-                int min = path_table_ver2[s.first][sink].cand[0].hops;
-                if (min == min_hops)
-                {
-                    src_candidate.push_back(s.first);
-                }
-            }
-
-            minimum_hop = min_hops;
+            minimum_hop = nearest_sources(sources[par_net_id], sink, src_candidate);
         }
 
         for (const auto &src : src_candidate)
@@ -1316,87 +2153,14 @@ void FPGA_Gr::global_routing_ver3()
                 cout << "src cand : " << src << endl;
             }*/
 
-            const auto &pt_init = path_table_ver2[src][sink];
-            for (const auto &cand : pt_init.cand)
-            {
-                int hops = cand.hops;
-
-                if (hops > minimum_hop + hop_limit)
-                {
-                    //cout << hops << endl;
-                    continue;
-                }
-
-                //cout << "cand hop = " << hops << endl;
-
-                /*if (par_net_id == 16100)
-                    cout << "cand hop = " << hops << endl;*/
-
-                for (const auto &par : cand.parent)
-                {
-                    vector<int> path;
-                    path.push_back(sink);
-                    path.push_back(par);
-                    auto pq = make_pair(path, hops - 1);
-                    path_queue.push(pq);
-
-                    //cout << "construct path\n";
-                    //cout << "push sink " << sink << endl;
-                    //cout << "push node " << par << endl;
-
-                    /*if (par_net_id == 16100)
-                    {
-                        cout << "construct path\n";
-                        cout << "push sink " << sink << endl;
-                        cout << "push node " << par << endl;
-                    }*/
-                }
-            }
-            //path_queue.push(path);
-
-            while (!path_queue.empty())
-            {
-                auto cur_path = path_queue.front();
-                path_queue.pop();
-                //cout << "pop path\n";
-
-                if (cur_path.first.back() == src) //done !
-                {
-                    cand_path.push_back(cur_path.first);
-                    continue;
-                }
-
-                auto pt = path_table_ver2[src][cur_path.first.back()];
-
-                for (auto &cand : pt.cand)
-                {
-                    if (cand.hops == 1 && cand.hops == cur_path.second)
-                    {
-                        auto temp_path = cur_path.first;
-                        temp_path.push_back(src);
-                        cand_path.push_back(temp_path);
-                        //cout << "push source " << src << endl;
-                    }
-                    else if (cand.hops == cur_path.second)
-                    {
-                        for (auto &par : cand.parent)
-                        {
-                            auto temp_path = cur_path.first;
-                            //cout << "push parent " << par << endl;
-                            temp_path.push_back(par);
-                            auto pq = make_pair(temp_path, cur_path.second - 1);
-                            path_queue.push(pq);
-                        }
-                    }
-                }
-            }
+            enum_cand_path(src, sink, minimum_hop + hop_limit, cand_buf);
         }
 
-        /*for (auto &path : cand_path)
+        /*for (int k = 0; k < cand_buf.size(); k++)
         {
-            for (auto &p : path)
+            for (int i = 0; i < cand_buf.len[k]; i++)
             {
-                cout << p << " ";
+                cout << cand_buf.path(k)[i] << " ";
             }
             cout << endl;
         }
@@ -1404,7 +2168,7 @@ void FPGA_Gr::global_routing_ver3()
 
         //try all candidate paths and route the best one
         double best = INT_MAX;
-        int index, count = 0;
+        int index = -1;
 
         /*if (par_net_id == 16100)
         {
@@ -1419,17 +2183,18 @@ void FPGA_Gr::global_routing_ver3()
                 }
                 cout << endl;
             }
-            cout << "cur sink = " << sb.first.sink << endl;
+            cout << "cur sink = " << sb.sink << endl;
             cout << "all candidates : \n";
         }*/
 
-        for (auto &path : cand_path)
+        for (int k = 0; k < cand_buf.size(); k++)
         {
-            int sink_num;
+            const int *path = cand_buf.path(k);
+            int &path_len = cand_buf.len[k];
 
             //檢查path是否提前連到tree上了導致dummy node
             int check_idx = 1;
-            for (int i = 1; i < path.size(); i++)
+            for (int i = 1; i < path_len; i++)
             {
                 if (sources[par_net_id].count(path[i]) > 0)
                 {
@@ -1438,69 +2203,93 @@ void FPGA_Gr::global_routing_ver3()
                 }
             }
             //pop多餘的點
-            if (check_idx < path.size() - 1)
+            if (check_idx < path_len - 1)
             {
-                for (int i = 0; i < path.size() - 1 - check_idx; i++)
-                {
-                    path.pop_back();
-                }
+                path_len = check_idx + 1;
             }
 
-            double cost = compute_cost_for_gr2(net[par_net_id], path, sb.first, sink_num);
+            cand_buf.order.push_back(make_pair(gr2_cost_lower_bound(path_len, sb.weight), k));
+        }
+        sort(cand_buf.order.begin(), cand_buf.order.end());
+
+        //cost the candidates from the smallest lower bound, a candidate stops being costed once it is over
+        //the best one and the rest are skipped once even their lower bound is, same result as costing all
+        for (const auto &o : cand_buf.order)
+        {
+            if (o.first > best)
+                break;
+
+            const int &k = o.second;
+            const int *path = cand_buf.path(k);
+            const int &path_len = cand_buf.len[k];
+            int sink_num;
+
+            double cost = compute_cost_for_gr2(net[par_net_id], path, path_len, sb, sink_num, best);
 
             /*if (par_net_id == 16100)
             {
-                cout << count << " : ";
-                for (auto &p : path)
+                cout << k << " : ";
+                for (int i = 0; i < path_len; i++)
                 {
-                    cout << p << " ";
+                    cout << path[i] << " ";
                 }
                 cout << ", sink num = " << sink_num;
                 cout << ", cost = " << cost << endl;
             }*/
 
-            if (cost < best)
+            if (cost < best || (cost == best && k < index))
             {
                 best = cost;
-                index = count;
+                index = k;
             }
-
-            count++;
         }
 
         //getchar();
 
-        allpaths[par_net_id].push_back(cand_path[index]);
+        if (index < 0)
+        {
+            cout << "[error] function(global_routing_ver3) no candidate path from net " << net_name.get(net[par_net_id].name_id) << " to " << fpga[sink].name() << endl;
+            exit(1);
+        }
+
+        const vector<int> best_path(cand_buf.path(index), cand_buf.path(index) + cand_buf.len[index]);
+        allpaths[par_net_id].push_back(best_path);
 
         /*if (par_net_id == 16100)
         {
             cout << "choose no." << index << endl;
         }*/
 
-        for (size_t i = 0; i < cand_path[index].size() - 1; i++)
+        for (size_t i = 0; i < best_path.size() - 1; i++)
         {
-            if (edge_lut[par_net_id].count(make_pair(cand_path[index][i + 1], cand_path[index][i])) == 0)
+            if (edge_lut[par_net_id].count(make_pair(best_path[i + 1], best_path[i])) == 0)
             {
-                edge_lut[par_net_id][make_pair(cand_path[index][i + 1], cand_path[index][i])] = 1;
-                add_channel_demand(cand_path[index][i + 1], cand_path[index][i]);
+                edge_lut[par_net_id][make_pair(best_path[i + 1], best_path[i])] = 1;
+                add_channel_demand(best_path[i + 1], best_path[i]);
             }
-            //sources[par_net_id].push_back(cand_path[index][i]);
-            sources[par_net_id][cand_path[index][i]] = 1;
+            //sources[par_net_id].push_back(best_path[i]);
+            sources[par_net_id][best_path[i]] = 1;
 
             /*if (par_net_id == 16100)
-                cout << "add " << cand_path[index][i] << " into sources\n";*/
+                cout << "add " << best_path[i] << " into sources\n";*/
         }
         //cout << "par = " << par_net_id << ", subnet : " << source << " " << sink << endl;
 
         total_time += ((double)(clock() - t2) / (double)CLOCKS_PER_SEC);
 
-        routing_subtree(net[par_net_id], cand_path[index]);                        //add path to routing tree
-        net[par_net_id].allpaths.push_back(make_pair(cand_path[index], sb.first)); //for rip-up and reroute
+        routing_subtree(net[par_net_id], best_path);                  //add path to routing tree
+        net[par_net_id].allpaths.push_back(make_pair(best_path, sb)); //for rip-up and reroute
 
         /*if (par_net_id == 16100)
             getchar();*/
     }
 
+    //subnets of the nets are routed in turn, so the trees are laid out once all of them are done
+    for (auto &n : net)
+    {
+        update_flat_tree(n);
+    }
+
     //cout << "route time = " << fixed << setprecision(2) << total_time << " seconds\n";
 
     //print allpaths
@@ -1536,39 +2325,121 @@ void FPGA_Gr::global_routing_ver3()
     delete[] sources;
 }
 
-double FPGA_Gr::compute_cost_for_gr2(Net &n, const vector<int> &path, const SubNet &sbnet, int &sink_num)
+void FPGA_Gr::enum_cand_path(const int &src, const int &sink, const int &hop_max, Cand_Path_Buffer &buf)
+{
+    //append all paths src --> sink of at most hop_max hops to buf (sink first),
+    //paths are walked back from sink level by level so they come out in BFS order
+    const auto pt_row = path_table_ver2[src];
+
+    buf.front.clear();
+    buf.front_remain.clear();
+    for (const auto &cand : pt_row[sink].cand)
+    {
+        if (cand.hops > hop_max)
+            continue;
+
+        for (const auto &par : cand.parent)
+        {
+            buf.front.push_back(sink);
+            buf.front.push_back(par);
+            buf.front_remain.push_back(cand.hops - 1);
+        }
+    }
+
+    int len = 2; //length of every partial path in front
+    while (!buf.front_remain.empty())
+    {
+        buf.next.clear();
+        buf.next_remain.clear();
+
+        for (size_t k = 0; k < buf.front_remain.size(); k++)
+        {
+            const int *cur_path = buf.front.data() + k * len;
+            const int &remain = buf.front_remain[k];
+
+            if (cur_path[len - 1] == src) //done !
+            {
+                buf.add_path(cur_path, len);
+                continue;
+            }
+
+            for (const auto &cand : pt_row[cur_path[len - 1]].cand)
+            {
+                if (cand.hops == 1 && cand.hops == remain)
+                {
+                    buf.add_path(cur_path, len);
+                    buf.node.push_back(src);
+                    buf.len.back()++;
+                }
+                else if (cand.hops == remain)
+                {
+                    for (const auto &par : cand.parent)
+                    {
+                        buf.next.insert(buf.next.end(), cur_path, cur_path + len);
+                        buf.next.push_back(par);
+                        buf.next_remain.push_back(remain - 1);
+                    }
+                }
+            }
+        }
+
+        buf.front.swap(buf.next);
+        buf.front_remain.swap(buf.next_remain);
+        len++;
+    }
+}
+
+int FPGA_Gr::nearest_sources(const map<int, int> &sources, const int &sink, vector<int> &src_candidate)
+{
+    //src_candidate = sources of the fewest min hops to sink (in source order), the row of each source is fetched once
+    int min_hops = INT_MAX;
+    src_candidate.clear();
+    for (const auto &s : sources)
+    {
+        const auto pt_row = path_table_ver2[s.first];
+        const Cand_list cand = pt_row[sink].cand;
+        if (cand.empty())
+            continue;
+
+        const int min = cand[0].hops; //candidates are sorted by hops
+        if (min < min_hops)
+        {
+            min_hops = min;
+            src_candidate.clear();
+        }
+        if (min == min_hops)
+            src_candidate.push_back(s.first);
+    }
+
+    return min_hops;
+}
+
+double FPGA_Gr::compute_cost_for_gr2(Net &n, const int *path, const int &path_len, const SubNet &sbnet, int &sink_num, const double &bound)
 {
     double cost = 0.0, cost_path = 0.0, appr_tdm = 0.0;
     double weight = sbnet.weight;
-    double hop_num = path.size() - 1;
+    double hop_num = path_len - 1;
     double total_used = 0.0, net_cost = 0.0;
     double total_his_cost = 0.0;
     double total_weight = 0.0;
     double cost_par = 0.0;
     sink_num = 1;
 
-    map<int, int> sink_lut;
-    for (const auto &sk : n.sink)
-    {
-        sink_lut[sk.id] = sk.weight;
-    }
-
-    for (size_t i = 0; i < path.size() - 1; i++)
+    for (int i = 0; i < path_len - 1; i++)
     {
-        int cap = channel_capacity[make_pair(path[i + 1], path[i])];
+        const int e = edge_index(path[i + 1], path[i]);
+        const int &direct = (path[i + 1] < path[i]) ? 0 : 1; //min-->max : 0, max-->min : 1
+        int cap = channel_capacity[2 * e + direct];
 
         cap = (cap == 0) ? 1 : cap;
 
         //double sig_weight = n.edge_crit[make_pair(path[i + 1], path[i])];
-        const int &direct = (path[i + 1] < path[i]) ? 0 : 1; //min-->max : 0, max-->min : 1
-        double ch_used = channel_used(path[i + 1], path[i]);
+        double ch_used = channel_demand[2 * e + direct];
 
         double before_tdm = (double)(ch_used) / (double)cap;
         double appr_tdm = (double)(ch_used + 1) / (double)cap; //src to sink appr. tdm
 
-        auto ch_name = get_channel_name(path[i], path[i + 1]);
-        auto ch = map_to_channel[ch_name];
-        double his_cost = ch->history_used[direct];
+        double his_cost = history_used[2 * e + direct];
 
         //check weight
 
@@ -1576,15 +2447,16 @@ double FPGA_Gr::compute_cost_for_gr2(Net &n, const vector<int> &path, const SubN
         {
             //check if current node is a sink ?
 
-            if (sink_lut.count(path[i]) > 0)
+            const int *sink_weight = n.sink_weight(path[i]);
+            if (sink_weight != NULL)
             {
                 sink_num++;
                 /*if (n.id == 5730)
                     cout <<  path[i] << " is a sink" << endl;*/
                 //check if sink weight is larger than current weight
-                if (sink_lut[path[i]] > weight)
+                if (*sink_weight > weight)
                 {
-                    weight = sink_lut[path[i]];
+                    weight = *sink_weight;
                 }
             }
         }
@@ -1605,9 +2477,14 @@ double FPGA_Gr::compute_cost_for_gr2(Net &n, const vector<int> &path, const SubN
         cost_par = cost_cur;
         cost_path += cost_cur;
         total_his_cost += his_cost / (double)round;
+
+        //weight never drops along the path, so once it is >= 0 every later hop adds >= 0
+        //and the cost can only grow : stop as soon as it is over bound
+        if (cost_path > bound && weight >= 0 && cost_par >= 0)
+            return cost_path;
     }
 
-    if (sink_lut.count(path.back()) > 0)
+    if (n.sink_weight(path[path_len - 1]) != NULL)
         sink_num++;
 
     cost = cost_path; //history + current path cost
@@ -1616,58 +2493,212 @@ double FPGA_Gr::compute_cost_for_gr2(Net &n, const vector<int> &path, const SubN
     return cost;
 }
 
+double FPGA_Gr::gr2_cost_lower_bound(const int &path_len, const double &weight)
+{
+    //every hop of compute_cost_for_gr2 adds at least weight + 6.5 (no history, tdm = 1) to cost_par,
+    //summed up the same way so the bound also holds after rounding
+    if (weight < 0)
+        return -DBL_MAX;
+
+    double cost_par = 0.0, cost_path = 0.0;
+    const double step = 1 * (weight + 6.5 * 1);
+    for (int i = 0; i < path_len - 1; i++)
+    {
+        cost_par = cost_par + step;
+        cost_path += cost_par;
+    }
+    return cost_path;
+}
+
 void FPGA_Gr::routing_tree(Net &n, const vector<vector<int>> &subpath)
 {
-    Tree_Node *root = new Tree_Node();
+    Tree_Node *root = tree_pool.get();
     root->parent = NULL;
     root->fpga_id = subpath[0].back(); //source
     n.rtree_root = root;
+    n.node_map.clear();
+    n.node_map.insert(root->fpga_id, root);
 
     for (const auto &path : subpath)
     {
         const int &par_id = path.back();
         //cout << "parent is fpga " << par_id << endl;
-        Tree_Node *parent = search_node(n.rtree_root, par_id);
+        Tree_Node *parent = n.node_map.find(par_id);
 
         //cout << "find parent fpga " << parent->fpga_id << endl;
 
         for (int i = path.size() - 2; i >= 0; i--)
         {
-            Tree_Node *new_node = new Tree_Node();
+            Tree_Node *new_node = tree_pool.get();
             new_node->fpga_id = path[i];
             new_node->parent = parent;
             parent->children.push_back(new_node);
+            n.node_map.insert(new_node->fpga_id, new_node);
             //cout << "add child fpga " << new_node->fpga_id << endl;
             parent = new_node;
         }
     }
-
-    compute_edge_weight(n, n.rtree_root);
+
+    compute_edge_weight(n, n.rtree_root);
+    update_flat_tree(n);
+}
+
+void FPGA_Gr::routing_subtree(Net &n, const vector<int> &subpath)
+{
+    if (n.rtree_root == NULL || n.rtree_root == nullptr)
+    {
+        Tree_Node *root = tree_pool.get();
+        root->parent = NULL;
+        root->fpga_id = subpath.back();
+        if (n.tree_sink_weight(root->fpga_id) != NULL)
+            root->sink_weight = *n.tree_sink_weight(root->fpga_id);
+        refresh_max_value(root);
+        n.rtree_root = root;
+        n.node_map.clear();
+        n.node_map.insert(root->fpga_id, root);
+    }
+
+    const int &par_id = subpath.back();
+    //cout << "parent is fpga " << par_id << endl;
+    Tree_Node *parent = n.node_map.find(par_id);
+    Tree_Node *attach = parent;
+
+    //cout << "find parent fpga " << parent->fpga_id << endl;
+
+    for (int i = subpath.size() - 2; i >= 0; i--)
+    {
+        Tree_Node *new_node = tree_pool.get();
+        new_node->fpga_id = subpath[i];
+        if (n.tree_sink_weight(subpath[i]) != NULL)
+            new_node->sink_weight = *n.tree_sink_weight(subpath[i]);
+        new_node->parent = parent;
+        parent->children.push_back(new_node);
+        n.node_map.insert(new_node->fpga_id, new_node);
+        parent = new_node;
+    }
+
+    //weights of the new nodes bottom-up, then only the ancestors of attach can change
+    for (Tree_Node *cur = parent; cur != attach; cur = cur->parent)
+        refresh_max_value(cur);
+    update_max_value(attach);
+}
+
+void FPGA_Gr::update_flat_tree(Net &n)
+{
+    //lay the routing tree of n out in flat_tree again, in its own slots if they are enough, else at the end of the buffer
+    auto &node = flat_tree.node;
+    auto &node_parent = flat_tree.node_parent;
+    node.clear();
+    node_parent.clear();
+    if (n.rtree_root != NULL)
+    {
+        node.push_back(n.rtree_root);
+        node_parent.push_back(-1);
+    }
+
+    for (size_t k = 0; k < node.size(); k++)
+    {
+        for (const auto &child : node[k]->children)
+        {
+            node.push_back(child);
+            node_parent.push_back(k);
+        }
+    }
+
+    const int size = node.size();
+    if (size > n.flat_cap)
+    {
+        //the old slots are left behind, the buffer is compacted once they outnumber the held ones
+        flat_tree.held -= n.flat_cap;
+        n.flat_size = n.flat_cap = 0;
+        if (flat_tree.size() > 2 * flat_tree.held)
+            compact_flat_tree();
+
+        n.flat_begin = flat_tree.size();
+        n.flat_cap = size;
+        flat_tree.held += size;
+        flat_tree.resize(n.flat_begin + size);
+    }
+
+    n.flat_size = size;
+    for (int k = 0; k < size; k++)
+    {
+        flat_tree.set(n.flat_begin + k, node[k], node_parent[k]);
+    }
+}
+
+void FPGA_Gr::compact_flat_tree()
+{
+    //move the trees of all nets to the front of the buffer in net order, a net holds only its own slots after it
+    Flat_Tree packed;
+    packed.resize(flat_tree.held);
+
+    size_t slot = 0;
+    for (auto &n : net)
+    {
+        packed.copy(flat_tree, n.flat_begin, slot, n.flat_size);
+        n.flat_begin = slot;
+        n.flat_cap = n.flat_size;
+        slot += n.flat_size;
+    }
+
+    packed.resize(slot);
+    packed.held = slot;
+    flat_tree.swap_slots(packed);
+}
+
+void FPGA_Gr::map_subtree(Net &n, Tree_Node *root) //add the nodes of a subtree attached to n's tree to n.node_map
+{
+    queue<Tree_Node *> fifo_queue;
+    fifo_queue.push(root);
+
+    while (fifo_queue.size() != 0)
+    {
+        Tree_Node *cur = fifo_queue.front();
+        fifo_queue.pop();
+
+        n.node_map.insert(cur->fpga_id, cur);
+        for (const auto &child : cur->children)
+        {
+            fifo_queue.push(child);
+        }
+    }
 }
 
-void FPGA_Gr::routing_subtree(Net &n, const vector<int> &subpath)
+void FPGA_Gr::unmap_subtree(Net &n, Tree_Node *root) //remove the nodes of a subtree cut from n's tree from n.node_map
 {
-    if (n.rtree_root == NULL || n.rtree_root == nullptr)
-    {
-        Tree_Node *root = new Tree_Node();
-        root->parent = NULL;
-        root->fpga_id = subpath.back();
-        n.rtree_root = root;
-    }
+    queue<Tree_Node *> fifo_queue;
+    fifo_queue.push(root);
+    bool lost = false;
 
-    const int &par_id = subpath.back();
-    //cout << "parent is fpga " << par_id << endl;
-    Tree_Node *parent = search_node(n.rtree_root, par_id);
+    while (fifo_queue.size() != 0)
+    {
+        Tree_Node *cur = fifo_queue.front();
+        fifo_queue.pop();
 
-    //cout << "find parent fpga " << parent->fpga_id << endl;
+        if (n.node_map.erase(cur->fpga_id, cur))
+            lost = true;
+        for (const auto &child : cur->children)
+        {
+            fifo_queue.push(child);
+        }
+    }
 
-    for (int i = subpath.size() - 2; i >= 0; i--)
+    //an fpga also left on the tree is mapped to its first node in BFS order again
+    if (lost && n.rtree_root != NULL)
     {
-        Tree_Node *new_node = new Tree_Node();
-        new_node->fpga_id = subpath[i];
-        new_node->parent = parent;
-        parent->children.push_back(new_node);
-        parent = new_node;
+        fifo_queue.push(n.rtree_root);
+        while (fifo_queue.size() != 0)
+        {
+            Tree_Node *cur = fifo_queue.front();
+            fifo_queue.pop();
+
+            n.node_map.refill(cur->fpga_id, cur);
+            for (const auto &child : cur->children)
+            {
+                fifo_queue.push(child);
+            }
+        }
     }
 }
 
@@ -1692,7 +2723,7 @@ void FPGA_Gr::record_net_channel_used()
             {
                 //紀錄channel內包含的net及對應edge weight (old)
                 auto ch_name = get_channel_name(cur->fpga_id, child->fpga_id);
-                Channel *chan = map_to_channel[ch_name];
+                Channel *chan = get_channel(ch_name);
                 pair<Net *, double> node;
                 node.first = n_ptr;
                 node.second = child->edge_weight; // 2/29 update !
@@ -1715,26 +2746,20 @@ void FPGA_Gr::record_net_channel_used()
 
 void FPGA_Gr::show_net_channel_table()
 {
-    for (const auto &ch : map_to_channel)
+    for (const auto &ch : channel)
     {
         /*
-        if (channel_demand[ch.first] == 0)
-        {
-            continue;
-        }
-
-        cout << "Channel (" << ch.first.first << ", " << ch.first.second << ") : " << endl;
-        cout << "Total used record in channel table : " << ch.second->net_ch_weight.size() << endl;
-        cout << "Total used record in channel_demand : " << channel_demand[ch.first] << endl;
+        cout << "Channel (" << ch->name.first << ", " << ch->name.second << ") : " << endl;
+        cout << "Total used record in channel table : " << ch->net_ch_weight.size() << endl;
         cout << "Check all channel have been recorded in net...";
         */
         bool check = true;
-        for (const auto &n : ch.second->net_ch_weight)
+        for (const auto &n : ch->net_ch_weight)
         {
             bool find = false;
             for (const auto &chan : n.first->channels) //search all channels in the net
             {
-                if (chan == ch.first)
+                if (chan == ch->name)
                 {
                     find = true;
                 }
@@ -1749,38 +2774,37 @@ void FPGA_Gr::show_net_channel_table()
 
 void FPGA_Gr::compute_edge_weight(Net &n, Tree_Node *root)
 {
-    //set all sink weight
-    queue<Tree_Node *> fifo_queue;
-    fifo_queue.push(root);
+    //set all sink weight, nodes are listed in BFS order so every child comes after its parent
+    vector<Tree_Node *> &order = tree_order;
+    order.clear();
+    order.push_back(root);
 
-    while (fifo_queue.size() != 0)
+    for (size_t k = 0; k < order.size(); k++)
     {
-        Tree_Node *cur = fifo_queue.front();
-        fifo_queue.pop();
+        Tree_Node *cur = order[k];
 
-        for (const auto &sink : n.sink)
-        {
-            if (sink.id == cur->fpga_id)
-            {
-                cur->sink_weight = sink.weight;
-                break;
-            }
-        }
+        const int *sink_weight = n.tree_sink_weight(cur->fpga_id);
+        if (sink_weight != NULL)
+            cur->sink_weight = *sink_weight;
 
-        for (auto &child : cur->children)
+        for (const auto &child : cur->children)
         {
-            fifo_queue.push(child);
+            order.push_back(child);
         }
     }
 
-    //set max value and edge weight
-    fifo_queue.push(root);
-    while (fifo_queue.size() != 0)
+    //set max value and edge weight bottom-up, max value of a node = max sink weight in its subtree (at least 0 below it)
+    for (size_t k = order.size(); k-- > 0;)
     {
-        Tree_Node *cur = fifo_queue.front();
-        fifo_queue.pop();
+        Tree_Node *cur = order[k];
+
+        int max = 0;
+        for (const auto &child : cur->children)
+        {
+            if (child->max_value > max)
+                max = child->max_value;
+        }
 
-        int max = max_weight(cur);
         if (max > cur->sink_weight)
         {
             cur->max_value = max;
@@ -1791,24 +2815,20 @@ void FPGA_Gr::compute_edge_weight(Net &n, Tree_Node *root)
             cur->max_value = cur->sink_weight;
             cur->edge_weight = cur->sink_weight;
         }
-
-        for (auto &child : cur->children)
-        {
-            fifo_queue.push(child);
-        }
     }
 }
 
 int FPGA_Gr::channel_used(int s, int t) //return channel(direct s-->t) used
 {
-    const int &demand = channel_demand[make_pair(s, t)];
+    const int &demand = channel_demand[direct_index(s, t)];
     return demand;
 }
 
 double FPGA_Gr::channel_TDM(int s, int t) //return src to target appr. TDM
 {
-    const int &demand = channel_demand[make_pair(s, t)];
-    double TDM = ceil((double)demand / (double)channel_capacity[make_pair(s, t)]);
+    const int idx = direct_index(s, t);
+    const int &demand = channel_demand[idx];
+    double TDM = ceil((double)demand / (double)channel_capacity[idx]);
     //TDM = (TDM <= 1) ? 1 : (int)ceil(TDM / 8) * 8;
     return TDM;
 }
@@ -1822,75 +2842,45 @@ double FPGA_Gr::compute_TDM_cost()
     for (auto &n : net)
     {
         n.net_initialize();
-
-        if (subnetbased)
-        {
-            compute_edge_weight(n, n.rtree_root);
-        }
-        //cout << n.name << endl;
+        //cout << net_name.get(n.name_id) << endl;
 
         n.cost = 0.0;
-        queue<Tree_Node *> fifo_queue;
-        for (const auto &child : n.rtree_root->children)
+        for (int k = n.flat_begin + 1; k < n.flat_begin + n.flat_size; k++)
         {
-            fifo_queue.push(child);
-            //n.edge_crit[make_pair(n.rtree_root->fpga_id, child->fpga_id)]++;
+            const int &par_id = flat_tree.fpga_id[n.flat_begin + flat_tree.parent[k]];
+            const int &cur_id = flat_tree.fpga_id[k];
+            const int &edge_weight = flat_tree.edge_weight[k];
+            //cout << "par cur = " << par_id << " " << cur_id << endl;
+            const int e = edge_index(par_id, cur_id);
+            const int idx = 2 * e + ((par_id < cur_id) ? 0 : 1);
             n.total_tree_edge++;
 
             //record signal pass channel
-            auto ch_name = get_channel_name(n.rtree_root->fpga_id, child->fpga_id);
-            auto ch = map_to_channel[ch_name];
-            int idx = (n.rtree_root->fpga_id > child->fpga_id) ? 1 : 0;
-            ch->passed_nets[idx].push_back(&n);
-        }
+            channel[e]->passed_nets[(par_id > cur_id) ? 1 : 0].push_back(&n);
 
-        while (fifo_queue.size() != 0)
-        {
-
-            Tree_Node *cur = fifo_queue.front();
-            fifo_queue.pop();
-
-            const int &par_id = cur->parent->fpga_id;
-            const int &cur_id = cur->fpga_id;
-            //cout << "par cur = " << par_id << " " << cur_id << endl;
-            double tdm_ratio = channel_TDM(par_id, cur_id);
+            double tdm_ratio = ceil((double)channel_demand[idx] / (double)channel_capacity[idx]);
 
             n.max_tdm = (tdm_ratio > n.max_tdm) ? tdm_ratio : n.max_tdm;
             n.min_tdm = (tdm_ratio < n.min_tdm) ? tdm_ratio : n.min_tdm;
 
             n.total_tdm += tdm_ratio;
-            n.cost += (tdm_ratio * (double)cur->edge_weight);
-            n.total_edge_weight += (double)cur->edge_weight;
+            n.cost += (tdm_ratio * (double)edge_weight);
+            n.total_edge_weight += (double)edge_weight;
             total_tdm_ratio += tdm_ratio;
 
             //紀錄net中channel資訊
-            auto ch_name = get_channel_name(par_id, cur_id);
-            Channel *chan = map_to_channel[ch_name];
-
             double repeat_ch = 1.0;
 
-            if (RRtimes.count(ch_name) > 0)
+            if (RRtimes[e] > 0)
             {
-                double times = RRtimes[ch_name];
+                double times = RRtimes[e];
                 repeat_ch -= (0.3 * times);
             }
-                
-            congestion_map[ch_name] += tdm_ratio * repeat_ch * (double)cur->edge_weight;
+
+            congestion_map[e] += tdm_ratio * repeat_ch * (double)edge_weight;
+            congestion_used[e] = true;
             maxtdm = (tdm_ratio > maxtdm) ? tdm_ratio : maxtdm;
             mintdm = (tdm_ratio < mintdm) ? tdm_ratio : mintdm;
-
-            for (auto &child : cur->children)
-            {
-                fifo_queue.push(child);
-                //n.edge_crit[make_pair(cur->fpga_id, child->fpga_id)]++;
-                n.total_tree_edge++;
-
-                //record signal pass channel
-                auto ch_name = get_channel_name(cur->fpga_id, child->fpga_id);
-                auto ch = map_to_channel[ch_name];
-                int idx = (cur->fpga_id > child->fpga_id) ? 1 : 0;
-                ch->passed_nets[idx].push_back(&n);
-            }
         }
 
         cost += n.cost;
@@ -1898,7 +2888,7 @@ double FPGA_Gr::compute_TDM_cost()
         n.signal_weight = n.cost / (double)n.sink.size();
         maxsgw = (n.signal_weight > maxsgw) ? n.signal_weight : maxsgw;
         minsgw = (n.signal_weight < minsgw) ? n.signal_weight : minsgw;
-        //cout << n.name << " => done !" << endl;
+        //cout << net_name.get(n.name_id) << " => done !" << endl;
     }
 
     /*-----------
@@ -1910,7 +2900,7 @@ double FPGA_Gr::compute_TDM_cost()
     avg_tdm_ratio = total_tdm_ratio / channel_demand.size();
     ------------*/
 
-    old_map_vec.clear();
+    fill(old_map_vec.begin(), old_map_vec.end(), 0);
     total_cost = cost;
     return cost;
 }
@@ -1987,7 +2977,7 @@ bool FPGA_Gr::find_rip_up_edge(Net &n, int &parent, int &child)
 Tree_Node *FPGA_Gr::rip_up_edge(Net &n, const int &par, const int &chi)
 {
     sub_channel_demand(par, chi);
-    Tree_Node *child = search_node(n.rtree_root, chi);
+    Tree_Node *child = n.node_map.find(chi);
     Tree_Node *parent = child->parent;
 
     //delete parent's child
@@ -2002,16 +2992,16 @@ Tree_Node *FPGA_Gr::rip_up_edge(Net &n, const int &par, const int &chi)
 
     //delete child's parent
     child->parent = NULL;
+    unmap_subtree(n, child);
+    update_max_value(parent);
 
     //delete used channel
-    int s = min(par, chi);
-    int t = max(par, chi);
-    Channel *ch = map_to_channel[make_pair(s, t)];
+    Channel *ch = get_channel(get_channel_name(par, chi));
 
     //delete this net from channel (old)
     for (auto it = ch->net_ch_weight.begin(); it != ch->net_ch_weight.end(); ++it)
     {
-        if (it->first->name == n.name)
+        if (it->first->id == n.id)
         {
             ch->net_ch_weight.erase(it);
             break;
@@ -2061,14 +3051,16 @@ void FPGA_Gr::reroute_edge(Net &n, const int &par, Tree_Node *child, double old_
 
     if (node_list.size() == 0) //cannot find node to reconnect => 恢復
     {
-        Tree_Node *parent = search_node(n.rtree_root, par);
+        Tree_Node *parent = n.node_map.find(par);
         child->parent = parent;
         parent->children.push_back(child);
+        map_subtree(n, child);
+        update_max_value(parent);
         add_channel_demand(parent->fpga_id, child->fpga_id);
 
         //將net加回去channel的net list中 (old)
         const auto ch_name = get_channel_name(parent->fpga_id, child->fpga_id);
-        Channel *target_ch = map_to_channel[ch_name];
+        Channel *target_ch = get_channel(ch_name);
         pair<Net *, double> node;
         node.first = &n;
         node.second = child->edge_weight;
@@ -2083,9 +3075,7 @@ void FPGA_Gr::reroute_edge(Net &n, const int &par, Tree_Node *child, double old_
         return;
     }
 
-    //compute current cost
-    compute_edge_weight(n, n.rtree_root);
-    compute_edge_weight(n, child);
+    //compute current cost (edge weights of both parts are kept current by rip_up_edge)
 
     double cur_cost = old_cost - n.cost + comptue_tree_TDM_cost(n.rtree_root) + comptue_tree_TDM_cost(child);
 
@@ -2128,29 +3118,30 @@ void FPGA_Gr::reroute_edge(Net &n, const int &par, Tree_Node *child, double old_
 
     //cout << "從起點往外擴一步..." << endl;
     //start to reconnect (先走一步)
-    for (const auto &nbr : fpga[start].nbr_pair)
+    for (int k = graph.offset[start]; k < graph.offset[start + 1]; k++)
     {
-        if (visit[nbr.first] == 1)
+        const int &nbr_id = graph.nbr[k];
+        if (visit[nbr_id] == 1)
         {
-            //cout << "已拜訪過 " << nbr.first << endl;
+            //cout << "已拜訪過 " << nbr_id << endl;
             continue;
         }
 
         vector<int> temp;      //用來存走過的路徑
         temp.push_back(start); //起點
-        temp.push_back(nbr.first);
+        temp.push_back(nbr_id);
 
         //針對有路過這個channel的所有net都要增加cost
         //cout << "針對有路過這個channel的所有net都要增加cost..." << endl;
-        auto ch_name = get_channel_name(start, nbr.first);
-        Channel *target_ch = map_to_channel[ch_name];
-        int ch_cap = target_ch->capacity;
+        auto ch_name = get_channel_name(start, nbr_id);
+        Channel *target_ch = get_channel(ch_name);
+        int ch_cap = edge_capacity[edge_index(start, nbr_id)];
 
-        double tdm_ratio = (double)(channel_used(start, nbr.first) + 1) / (double)ch_cap;
+        double tdm_ratio = (double)(channel_used(start, nbr_id) + 1) / (double)ch_cap;
 
         //計算受影響net的cost增加量總和
         double increased_value = 0.0;
-        double old_tdm = channel_TDM(start, nbr.first);
+        double old_tdm = channel_TDM(start, nbr_id);
         for (auto &inf_net : target_ch->net_ch_weight)
         {
             //cout << "new tdm ratio = " << tdm_ratio << ", old tdm ratio = " << old_tdm << ", edge weight = " << setw(2) << inf_net.second << "  : ";
@@ -2165,7 +3156,7 @@ void FPGA_Gr::reroute_edge(Net &n, const int &par, Tree_Node *child, double old_
         //cout << "increase " << cur_increased_value << endl;
 
         path_queue.push(make_pair(temp, cur_increased_value + increased_value));
-        visit[nbr.first] = 1;
+        visit[nbr_id] = 1;
         count++;
 
         //print path
@@ -2224,21 +3215,22 @@ void FPGA_Gr::reroute_edge(Net &n, const int &par, Tree_Node *child, double old_
         }
 
         //還沒到目的地，繼續走下一步
-        for (const auto &nbr : fpga[path.first.back()].nbr_pair)
+        for (int k = graph.offset[path.first.back()]; k < graph.offset[path.first.back() + 1]; k++)
         {
-            if (visit[nbr.first] == 1)
+            const int &nbr_id = graph.nbr[k];
+            if (visit[nbr_id] == 1)
             {
                 continue;
             }
 
             pair<vector<int>, double> temp = path;
             int cur = temp.first.back();
-            temp.first.push_back(nbr.first);
+            temp.first.push_back(nbr_id);
             int next = temp.first.back();
 
             auto ch_name = get_channel_name(cur, next);
-            Channel *target_ch = map_to_channel[ch_name];
-            int ch_cap = target_ch->capacity;
+            Channel *target_ch = get_channel(ch_name);
+            int ch_cap = edge_capacity[edge_index(cur, next)];
 
             double tdm_ratio = (double)(channel_used(cur, next) + 1) / (double)ch_cap;
 
@@ -2259,7 +3251,7 @@ void FPGA_Gr::reroute_edge(Net &n, const int &par, Tree_Node *child, double old_
 
             temp.second += increased_value + cur_increased_value;
             path_queue.push(temp);
-            visit[nbr.first] = 1;
+            visit[nbr_id] = 1;
             count++;
 
             //print path
@@ -2291,15 +3283,17 @@ void FPGA_Gr::reroute_edge(Net &n, const int &par, Tree_Node *child, double old_
 
         for (size_t i = 1; i < cand_path.size() - 1; i++)
         {
-            Tree_Node *new_node = new Tree_Node();
+            Tree_Node *new_node = tree_pool.get();
             new_node->fpga_id = cand_path[i];
+            if (n.tree_sink_weight(cand_path[i]) != NULL)
+                new_node->sink_weight = *n.tree_sink_weight(cand_path[i]);
             cur->parent = new_node;
             new_node->children.push_back(cur);
             add_channel_demand(cur->fpga_id, cand_path[i]);
             //cout << cur->fpga_id << " " << cand_path[i] << endl;
 
             auto ch_name = get_channel_name(cur->fpga_id, cand_path[i]);
-            Channel *target_ch = map_to_channel[ch_name];
+            Channel *target_ch = get_channel(ch_name);
             //cout << "route channel " << ch_name.first << " " << ch_name.second << endl;
 
             //新增net增加的channel
@@ -2316,10 +3310,14 @@ void FPGA_Gr::reroute_edge(Net &n, const int &par, Tree_Node *child, double old_
 
         cur->parent = target;
         target->children.push_back(cur);
+        map_subtree(n, cur);
+        for (Tree_Node *node = child->parent; node != target; node = node->parent)
+            refresh_max_value(node);
+        update_max_value(target);
         add_channel_demand(cur->fpga_id, target->fpga_id);
 
         const auto &ch_name = get_channel_name(cur->fpga_id, target->fpga_id);
-        Channel *target_ch = map_to_channel[ch_name];
+        Channel *target_ch = get_channel(ch_name);
 
         //新增net增加的channel
         n.channels.push_back(ch_name);
@@ -2332,13 +3330,15 @@ void FPGA_Gr::reroute_edge(Net &n, const int &par, Tree_Node *child, double old_
     }
     else
     {
-        Tree_Node *parent = search_node(n.rtree_root, par);
+        Tree_Node *parent = n.node_map.find(par);
         child->parent = parent;
         parent->children.push_back(child);
+        map_subtree(n, child);
+        update_max_value(parent);
         add_channel_demand(parent->fpga_id, child->fpga_id);
 
         const auto &ch_name = get_channel_name(parent->fpga_id, child->fpga_id);
-        Channel *target_ch = map_to_channel[ch_name];
+        Channel *target_ch = get_channel(ch_name);
 
         //新增net增加的channel
         n.channels.push_back(ch_name);
@@ -2378,6 +3378,7 @@ void FPGA_Gr::rip_up_reroute(time_t t)
             child = rip_up_edge(n, par, chi);
             double old_cost = total_cost;
             reroute_edge(n, par, child, old_cost);
+            update_flat_tree(n);
             double new_cost = total_cost;
 
             if (new_cost < old_cost)
@@ -2404,7 +3405,6 @@ void FPGA_Gr::rip_up_reroute(time_t t)
 vector<pair<int, int>> FPGA_Gr::sub_allchannels(Net &n, Tree_Node *sbtree_root, vector<SubNet> &allsubnets, map<int, int> &all_rip_nodes) //return all channels of tree and 把 channel的demand都-1 (RR用)
 {
     vector<pair<int, int>> allchannels;
-    map<int, int> sink_lut;
 
     if (sbtree_root == NULL)
     {
@@ -2412,11 +3412,6 @@ vector<pair<int, int>> FPGA_Gr::sub_allchannels(Net &n, Tree_Node *sbtree_root,
         exit(1);
     }
 
-    for (const auto &sk : n.sink) //把net中所有sink放入lut中
-    {
-        sink_lut[sk.id] = 1;
-    }
-
     queue<Tree_Node *> fifo_queue;
     fifo_queue.push(sbtree_root);
 
@@ -2427,7 +3422,7 @@ vector<pair<int, int>> FPGA_Gr::sub_allchannels(Net &n, Tree_Node *sbtree_root,
         all_rip_nodes[cur->fpga_id] = 1;
 
         //check當前pop出來的點是不是sink
-        if (sink_lut.count(cur->fpga_id) != 0)
+        if (n.sink_weight(cur->fpga_id) != NULL)
         {
             SubNet temp;
             temp.source = n.source;
@@ -2590,7 +3585,7 @@ void FPGA_Gr::max_subpath_RR() //RR
             show_tree(n.rtree_root);
         }*/
 
-        Tree_Node *node = search_node(n.rtree_root, rip_fpga_id);
+        Tree_Node *node = n.node_map.find(rip_fpga_id);
         Tree_Node *node_par = node->parent;
 
         //cout << "before" << endl;
@@ -2625,10 +3620,11 @@ void FPGA_Gr::max_subpath_RR() //RR
         sub_channel_demand(last_chan.first, last_chan.second);
         inf_channel_sub.push_back(last_chan);
         last_rip->parent = NULL; //delete node parent
+        unmap_subtree(n, last_rip);
+        update_max_value(node_par);
 
         //cout << "-----------------\n";
         //cout << "after" << endl;
-        compute_edge_weight(n, n.rtree_root);
         //show_tree(n.rtree_root);
 
         /*if (n.id == 3236)
@@ -2641,6 +3637,7 @@ void FPGA_Gr::max_subpath_RR() //RR
         vector<SubNet> allsubnets;                                               //要reroute的sink
         auto influence = sub_allchannels(n, last_rip, allsubnets, rip_node_lut); //把受影響channel的demand都-1，並記錄下來，以及找出要reroute的sink
         inf_channel_sub.insert(inf_channel_sub.end(), influence.begin(), influence.end());
+        tree_pool.release_tree(last_rip); //cut subtree is not needed after its channels and sinks are read
 
         /*-------------------------------------更新net中allpaths的資訊-------------------------------------*/
         /*for (const auto &sb : allsubnets)
@@ -2762,8 +3759,9 @@ void FPGA_Gr::max_subpath_RR() //RR
             int min_hops = INT_MAX;
             for (const auto &s : sources)
             {
+                const auto pt_row = path_table_ver2[s.first];
                 int min = INT_MAX;
-                for (const auto &cand : path_table_ver2[s.first][sink].cand)
+                for (const auto &cand : pt_row[sink].cand)
                 {
                     if (cand.hops < min)
                     {
@@ -2789,7 +3787,8 @@ void FPGA_Gr::max_subpath_RR() //RR
 
             for (const auto &src : src_candidate)
             {
-                const auto &pt_init = path_table_ver2[src][sink];
+                const auto pt_row = path_table_ver2[src];
+                const auto &pt_init = pt_row[sink];
                 for (const auto &cand : pt_init.cand)
                 {
                     int hops = cand.hops;
@@ -2828,7 +3827,7 @@ void FPGA_Gr::max_subpath_RR() //RR
                         continue;
                     }
 
-                    auto pt = path_table_ver2[src][cur_path.first.back()];
+                    auto pt = pt_row[cur_path.first.back()];
 
                     for (auto &cand : pt.cand)
                     {
@@ -2946,12 +3945,6 @@ void FPGA_Gr::max_subpath_RR() //RR
             routing_subtree(n, cand_path[index]); //add path to routing tree
         }
 
-        //delete_tree(n.rtree_root);
-        //n.total_tree_edge = 0;
-        //n.rtree_root = NULL;
-        //delete_tree(last_rip);
-        //routing_tree(n, allpaths);
-
         //cout << "-----------------\n";
         /*cout << "reroute paths : " << endl;
         for (const auto &path : allpaths)
@@ -2966,14 +3959,13 @@ void FPGA_Gr::max_subpath_RR() //RR
         //after tree
         //cout << "-----------------\n";
         //cout << "after tree : \n";
-        compute_edge_weight(n, n.rtree_root); //更新edge weight資訊
         double new_net_cost = comptue_tree_TDM_cost(n.rtree_root);
         new_cost += new_net_cost;
 
         if (new_cost < old_cost)
         {
             /*
-            cout << n.name << " : ";
+            cout << net_name.get(n.name_id) << " : ";
             cout << "new net cost = " << new_net_cost << endl;
             cout << "old cost = " << old_cost << ", new cost = " << new_cost << endl;
             cout << " ---> update cost !!" << endl;
@@ -2987,11 +3979,12 @@ void FPGA_Gr::max_subpath_RR() //RR
         else //還原
         {
             /*
-            cout << n.name << " : ";
+            cout << net_name.get(n.name_id) << " : ";
             cout << "old cost = " << old_cost << ", new cost = " << new_cost << endl;
             */
             n.allpaths = old_netallpaths;
-            delete_tree(n.rtree_root);
+            tree_pool.release_tree(n.rtree_root);
+            n.node_map.clear();
 
             /*if (n.id == 3236)
             {
@@ -3018,8 +4011,6 @@ void FPGA_Gr::max_subpath_RR() //RR
                 add_channel_demand(ch.first, ch.second);
             }
             /*-------------------------------------------------------------------------------------------------*/
-
-            compute_edge_weight(n, n.rtree_root);
             //cout << "還原 cost --->" << comptue_tree_TDM_cost(n.rtree_root) + new_cost - new_net_cost << endl;
             //cout << endl;
             //getchar();
@@ -3041,6 +4032,8 @@ void FPGA_Gr::max_subpath_RR() //RR
             }
             getchar();
         }*/
+
+        update_flat_tree(n); //the tree was cut and rerouted, or routed again from the old paths
     }
 
     //cout << "ok" << endl;
@@ -3136,9 +4129,9 @@ void FPGA_Gr::subtree_sink_RR() //SRT RR
             }
         }
 
-        //cout << "rip " << n.name << " node F" << rip_fpga_id << endl;
+        //cout << "rip " << net_name.get(n.name_id) << " node F" << rip_fpga_id << endl;
 
-        Tree_Node *node = search_node(n.rtree_root, rip_fpga_id);
+        Tree_Node *node = n.node_map.find(rip_fpga_id);
 
         if (node == nullptr || node->fpga_id == n.source)
             continue;
@@ -3173,13 +4166,14 @@ void FPGA_Gr::subtree_sink_RR() //SRT RR
         sub_channel_demand(last_chan.first, last_chan.second);
         inf_channel_sub.push_back(last_chan);
         last_rip->parent = NULL; //delete node parent
-
-        compute_edge_weight(n, n.rtree_root);
+        unmap_subtree(n, last_rip);
+        update_max_value(node_par);
 
         map<int, int> rip_node_lut;                                              //存放所有被拔掉的點
         vector<SubNet> allsubnets;                                               //要reroute的sink
         auto influence = sub_allchannels(n, last_rip, allsubnets, rip_node_lut); //把受影響channel的demand都-1，並記錄下來，以及找出要reroute的sink
         inf_channel_sub.insert(inf_channel_sub.end(), influence.begin(), influence.end());
+        tree_pool.release_tree(last_rip); //cut subtree is not needed after its channels and sinks are read
 
         /*--------------------------------------backup old allpaths--------------------------------*/
         vector<vector<int>> old_allpaths;
@@ -3215,36 +4209,12 @@ void FPGA_Gr::subtree_sink_RR() //SRT RR
             queue<pair<vector<int>, int>> path_queue; //(path, 剩餘hop)
             int minimum_hop;
 
-            int min_hops = INT_MAX;
-            for (const auto &s : sources)
-            {
-                int min = INT_MAX;
-                for (const auto &cand : path_table_ver2[s.first][sink].cand)
-                {
-                    if (cand.hops < min)
-                    {
-                        min = cand.hops;
-                    }
-                }
-                const int &tmp = min;
-                if (tmp < min_hops && tmp != 0)
-                    min_hops = tmp;
-                //src_candidate.push_back(s.first);
-            }
-
-            for (const auto &s : sources)
-            {
-                if (path_table_ver2[s.first][sink].cand[0].hops == min_hops)
-                {
-                    src_candidate.push_back(s.first);
-                }
-            }
-
-            minimum_hop = min_hops;
+            minimum_hop = nearest_sources(sources, sink, src_candidate);
 
             for (const auto &src : src_candidate)
             {
-                const auto &pt_init = path_table_ver2[src][sink];
+                const auto pt_row = path_table_ver2[src];
+                const auto &pt_init = pt_row[sink];
                 for (const auto &cand : pt_init.cand)
                 {
                     int hops = cand.hops;
@@ -3275,7 +4245,7 @@ void FPGA_Gr::subtree_sink_RR() //SRT RR
                         continue;
                     }
 
-                    auto pt = path_table_ver2[src][cur_path.first.back()];
+                    auto pt = pt_row[cur_path.first.back()];
 
                     for (auto &cand : pt.cand)
                     {
@@ -3353,7 +4323,6 @@ void FPGA_Gr::subtree_sink_RR() //SRT RR
             routing_subtree(n, cand_path[index]); //add path to routing tree
         }
 
-        compute_edge_weight(n, n.rtree_root); //更新edge weight資訊
         double new_net_cost = comptue_tree_TDM_cost(n.rtree_root);
         new_cost += new_net_cost;
 
@@ -3365,7 +4334,8 @@ void FPGA_Gr::subtree_sink_RR() //SRT RR
         else //還原
         {
             n.allpaths = old_netallpaths;
-            delete_tree(n.rtree_root);
+            tree_pool.release_tree(n.rtree_root);
+            n.node_map.clear();
             routing_tree(n, old_allpaths);
 
             /*----------------------------------------還原受影響channel----------------------------------------*/
@@ -3379,9 +4349,9 @@ void FPGA_Gr::subtree_sink_RR() //SRT RR
                 add_channel_demand(ch.first, ch.second);
             }
             /*-------------------------------------------------------------------------------------------------*/
-
-            compute_edge_weight(n, n.rtree_root);
         }
+
+        update_flat_tree(n); //the tree was cut and rerouted, or routed again from the old paths
     }
 }
 
@@ -3396,75 +4366,63 @@ void FPGA_Gr::check_result()
     cout << "check all signals have been routed correctly...";
     for (const auto &n : net)
     {
-        if (n.rtree_root->fpga_id != n.source) //檢查tree的root是否為net的source
+        const int &root_id = flat_tree.fpga_id[n.flat_begin];
+        if (root_id != n.source) //檢查tree的root是否為net的source
         {
             cout << "Error" << endl;
-            cout << n.name << "'s source = " << n.source << "<----->" << n.rtree_root->fpga_id << " = tree root" << endl;
+            cout << net_name.get(n.name_id) << "'s source = " << fpga[n.source].name() << "<----->" << fpga[root_id].name() << " = tree root" << endl;
             //exit(1);
         }
 
         list<int> net_terminal;
-        queue<Tree_Node *> fifo_queue;
-        fifo_queue.push(n.rtree_root);
-
         net_terminal.push_back(n.source);
         for (const auto &sk : n.sink)
         {
             net_terminal.push_back(sk.id);
         }
 
-        while (!fifo_queue.empty())
+        net_terminal.remove(root_id);
+        for (int k = n.flat_begin + 1; k < n.flat_begin + n.flat_size; k++)
         {
-            Tree_Node *cur = fifo_queue.front();
-            fifo_queue.pop();
-            net_terminal.remove(cur->fpga_id);
-
-            for (const auto &chi : cur->children)
-            {
-                // check相連的child元素是否為parent鄰居
-                bool find = false;
-                for (const auto &nbr : fpga[cur->fpga_id].nbr_pair)
-                {
-                    if (chi->fpga_id == nbr.first)
-                    {
-                        find = true;
-                        break;
-                    }
-                }
+            //children come in the order their parents are visited, so the checks run in BFS order
+            const int par = n.flat_begin + flat_tree.parent[k];
+            const int &par_id = flat_tree.fpga_id[par];
+            const int &cur_id = flat_tree.fpga_id[k];
+            net_terminal.remove(cur_id);
 
-                if (!find)
-                {
-                    cout << "Error" << endl;
-                    cout << n.name << " : " << chi->fpga_id << " is not the neighbor of " << cur->fpga_id << " !\n";
-                    //exit(1);
-                }
+            // check相連的child元素是否為parent鄰居
+            bool find = (graph.find(par_id, cur_id) >= 0);
 
-                //check edge weight是否正確
-                if (cur->edge_weight < chi->sink_weight)
-                {
-                    cout << "Error" << endl;
-                    cout << n.name << " : parent edge_weight = " << cur->edge_weight << " must >= child sink weight = " << chi->sink_weight << endl;
-                    //exit(1);
-                }
+            if (!find)
+            {
+                cout << "Error" << endl;
+                cout << net_name.get(n.name_id) << " : " << fpga[cur_id].name() << " is not the neighbor of " << fpga[par_id].name() << " !\n";
+                //exit(1);
+            }
 
-                if (cur->edge_weight != cur->max_value)
-                {
-                    cout << "Error" << endl;
-                    cout << n.name << " : " << cur->fpga_id << "'s edge weight error or max value error" << endl;
-                    //exit(1);
-                }
+            //check edge weight是否正確
+            if (flat_tree.edge_weight[par] < flat_tree.sink_weight[k])
+            {
+                cout << "Error" << endl;
+                cout << net_name.get(n.name_id) << " : parent edge_weight = " << flat_tree.edge_weight[par] << " must >= child sink weight = " << flat_tree.sink_weight[k] << endl;
+                //exit(1);
+            }
 
-                fifo_queue.push(chi);
+            if (flat_tree.edge_weight[par] != flat_tree.max_value[par])
+            {
+                cout << "Error" << endl;
+                cout << net_name.get(n.name_id) << " : " << fpga[par_id].name() << "'s edge weight error or max value error" << endl;
+                //exit(1);
             }
         }
 
         if (!net_terminal.empty())
         {
             cout << "Error" << endl;
-            cout << n.name << " : ";
+            cout << net_name.get(n.name_id) << " : ";
             for (const auto &id : net_terminal)
             {
-                cout << id << " ";
+                cout << fpga[id].name() << " ";
             }
             cout << "did not be routed" << endl;
             //exit(1);
@@ -3479,20 +4437,16 @@ void FPGA_Gr::initial_route_result()
     int ch_num = channel_demand.size();
     double avg_use = (double)total_demand / (double)ch_num;
 
-    for (auto &ch : map_to_channel)
-    {
-        ch.second->history_used[0] = ch.second->history_used[1] = 0;
-    }
+    fill(history_used.begin(), history_used.end(), 0);
 
-    for (auto &chd : channel_demand)
+    for (int idx = 0; idx < 2 * edge_num; idx++)
     {
-        int direct = (chd.first.first < chd.first.second) ? 0 : 1; //min-->max : 0, max-->min : 1
-        int cap = channel_capacity[chd.first];
-        auto ch_name = get_channel_name(chd.first.first, chd.first.second);
-        auto ch = map_to_channel[ch_name];
+        int direct = idx % 2; //min-->max : 0, max-->min : 1
+        int cap = channel_capacity[idx];
+        auto ch = channel[idx / 2];
 
-        auto demand = chd.second;
-        int cur_channel_tdm = (int)ceil((double)chd.second / (double)cap);
+        auto demand = channel_demand[idx];
+        int cur_channel_tdm = (int)ceil((double)demand / (double)cap);
         double his_cost = 0.0;
         double times = 1; //控制map的範圍-->ex. times = 2 --> map to [0,1]*2 + 1 = [1,3]
 
@@ -3522,7 +4476,7 @@ void FPGA_Gr::initial_route_result()
             his_cost = 0;
         }*/
 
-        ch->history_used[direct] += his_cost;
+        history_used[idx] += his_cost;
     }
 
     //sorted net by tree edge num
@@ -3531,16 +4485,15 @@ void FPGA_Gr::initial_route_result()
     //delete route tree
     for (auto &n : net)
     {
-        delete_tree(n.rtree_root);
+        tree_pool.release_tree(n.rtree_root);
+        n.node_map.clear();
         n.total_tree_edge = 0;
         n.rtree_root = NULL;
+        update_flat_tree(n);
     }
 
     //initial channel demand
-    for (auto &ch : channel_demand)
-    {
-        ch.second = 0;
-    }
+    fill(channel_demand.begin(), channel_demand.end(), 0);
 
     total_demand = 0;
     mintdm = INT_MAX;
@@ -3549,26 +4502,26 @@ void FPGA_Gr::initial_route_result()
 
 void FPGA_Gr::show_congestion_map()
 {
-    for (const auto &ch : map_to_channel)
+    for (int e = 0; e < edge_num; e++)
     {
-        if (ch.second->capacity == 0)
-            continue;
+        const auto &ch_name = edge_name[e];
+        auto ch = channel[e];
 
-        cout << "Channel Name : (" << ch.first.first << ", " << ch.first.second << ")\n";
-        cout << "TDM_0 : " << channel_TDM(ch.first.first, ch.first.second) << endl;
-        cout << "TDM_1 : " << channel_TDM(ch.first.second, ch.first.first) << endl;
+        cout << "Channel Name : (" << fpga[ch_name.first].name() << ", " << fpga[ch_name.second].name() << ")\n";
+        cout << "TDM_0 : " << channel_TDM(ch_name.first, ch_name.second) << endl;
+        cout << "TDM_1 : " << channel_TDM(ch_name.second, ch_name.first) << endl;
 
         /*
         cout << "Nets_0: ";
-        for (const auto &n : ch.second->passed_nets[0])
+        for (const auto &n : ch->passed_nets[0])
         {
-            cout << n->name << ", ";
+            cout << net_name.get(n->name_id) << ", ";
         }
         cout << endl;
         cout << "Nets_1: ";
-        for (const auto &n : ch.second->passed_nets[1])
+        for (const auto &n : ch->passed_nets[1])
         {
-            cout << n->name << ", ";
+            cout << net_name.get(n->name_id) << ", ";
         }
         cout << endl;
         */
@@ -3580,9 +4533,10 @@ void FPGA_Gr::show_congestion_map()
 void FPGA_Gr::congestion_RR() //CRR
 {
     //sort congestion map
-    for (const auto &cm : congestion_map)
+    for (int e = 0; e < edge_num; e++)
     {
-        cong_map_vec.push_back(make_pair(cm.first, cm.second));
+        if (congestion_used[e])
+            cong_map_vec.push_back(make_pair(e, congestion_map[e]));
     }
     sort(cong_map_vec.begin(), cong_map_vec.end(), comp_conj_vec_map);
 
@@ -3594,23 +4548,23 @@ void FPGA_Gr::congestion_RR() //CRR
     for (int i = 0; i < rip_num; i++)
     {
         //int dir = (cong_map_vec[i].first.first > cong_map_vec[i].first.second) ? 1 : 0;
-        auto ch_name = cong_map_vec[i].first;
-        auto ch = map_to_channel[ch_name];
+        const int &e = cong_map_vec[i].first;
+        auto ch = channel[e];
 
-        old_map_vec[ch_name] = 1;
-        add_ch_RRtimes(ch_name);
+        old_map_vec[e] = 1;
+        add_ch_RRtimes(e);
 
         //cout << "\t(" << ch_name.first << ", " << ch_name.second << ")" << endl;
 
         for (auto &n : ch->passed_nets[0])
         {
-            if (n->chan_penalty.count(ch_name) > 0)
+            if (n->chan_penalty.count(e) > 0)
             {
-                n->chan_penalty[ch_name] += 0.05;
+                n->chan_penalty[e] += 0.05;
             }
             else
             {
-                n->chan_penalty[ch_name] = 1.05; //防止再走回原channel
+                n->chan_penalty[e] = 1.05; //防止再走回原channel
             }
 
             //rip_net_set.push_back(n);
@@ -3691,16 +4645,12 @@ void FPGA_Gr::congestion_RR() //CRR
     for (const auto &rip_net_crit : ripped_net)
     {
         auto n_ptr = rip_net_crit.first; //point to ripped_net
-        reroute_net(n_ptr);
-        compute_edge_weight(*n_ptr, n_ptr->rtree_root);
+        reroute_net(n_ptr); //edge weights are kept by routing_subtree
         //show_tree(n_ptr->rtree_root);
     }
 
     //reset congestion map
-    for (auto &cm : congestion_map)
-    {
-        cm.second = 0;
-    }
+    fill(congestion_map.begin(), congestion_map.end(), 0);
     cong_map_vec.clear();
 
     round++;
@@ -3711,7 +4661,7 @@ void FPGA_Gr::set_after_conj_cost()
     /*after_conj_cost.resize(10);
     for (int i = 0; i < 10; i++)
     {
-        auto conj_cost = congestion_map[make_pair(cong_map_vec[i].first.first, cong_map_vec[i].first.second)];
+        auto conj_cost = congestion_map[cong_map_vec[i].first];
         after_conj_cost[i] = conj_cost;
     }
 
@@ -3720,14 +4670,10 @@ void FPGA_Gr::set_after_conj_cost()
 
 void FPGA_Gr::update_history_cost()
 {   
-    for (auto &chd : channel_demand)
+    for (int idx = 0; idx < 2 * edge_num; idx++)
     {
-        int direct = (chd.first.first < chd.first.second) ? 0 : 1; //min-->max : 0, max-->min : 1
-        int cap = channel_capacity[chd.first];
-        auto ch_name = get_channel_name(chd.first.first, chd.first.second);
-        auto ch = map_to_channel[ch_name];
-
-        int cur_channel_tdm = (int)ceil((double)chd.second / (double)cap);
+        int cap = channel_capacity[idx];
+        int cur_channel_tdm = (int)ceil((double)channel_demand[idx] / (double)cap);
         double his_cost = 0.0;
 
         if (cur_channel_tdm > 1)
@@ -3736,16 +4682,16 @@ void FPGA_Gr::update_history_cost()
             {
                 if(after_conj_cost[i] >= cong_map_vec[i].second)
                 {
-                    ch->history_penalty[direct] += 0.2;
+                    history_penalty[idx] += 0.2;
                     break;
                 }
             }*/
 
-            ch->history_cost[direct] = cur_channel_tdm * ch->history_penalty[direct];
+            history_cost[idx] = cur_channel_tdm * history_penalty[idx];
         }
         else
         {
-            ch->history_cost[direct] = 0;
+            history_cost[idx] = 0;
         }
     }
 }
@@ -3754,33 +4700,32 @@ void FPGA_Gr::reroute_net(Net *n)
 {
     //subnetbased = true;
     int hop_limit = LIMIT_HOP; //最多嘗試與最小hop數差幾個hop的限制條件
-    vector<pair<SubNet, int>> subnet_order;
+    vector<SubNet_Ref> subnet_order;
     vector<vector<int>> allpaths; //紀錄每個net的所有subpath
     map<pair<int, int>, int> edge_lut;
     map<int, int> sources;
 
     //算出subnet weight決定routing order
-    for (auto &sb : n->sbnet)
-    {
-        pair<SubNet, int> temp;
-        const int &src = sb.source;
-        const int &sink = sb.sink;
-        const int &hops = path_table_ver2[src][sink].cand[0].hops;
-        int weight = sb.weight;
-        temp = make_pair(sb, weight);
+    for (size_t i = 0; i < n->sbnet.size(); i++)
+    {
+        SubNet_Ref temp;
+        temp.weight = n->sbnet[i].weight;
+        temp.net_id = n->id;
+        temp.sb_id = i;
         subnet_order.push_back(temp);
     }
-    sort(subnet_order.begin(), subnet_order.end(), comp_sbnetcost);
+    sort_subnet_order(subnet_order);
 
     double total_time = 0.0;
 
     //start to route subnet
     int sub_order = 0;
-    for (auto &sb : subnet_order)
+    for (const auto &order : subnet_order)
     {
         auto t2 = clock();
-        int source = sb.first.source;
-        int sink = sb.first.sink;
+        const SubNet &sb = n->sbnet[order.sb_id];
+        int source = sb.source;
+        int sink = sb.sink;
 
         //check 這個 sink 是不是被 route 過
         if (sources.count(sink) > 0)
@@ -3789,10 +4734,10 @@ void FPGA_Gr::reroute_net(Net *n)
         }
 
         //start to routing
-        vector<vector<int>> cand_path;
-        vector<int> src_candidate;
+        cand_buf.clear();
+        vector<int> &src_candidate = cand_buf.src_candidate;
+        src_candidate.clear();
         int cur_node = source;
-        queue<pair<vector<int>, int>> path_queue; //(path, 剩餘hop)
         int minimum_hop;
 
         if (sources.size() == 0)
@@ -3803,102 +4748,26 @@ void FPGA_Gr::reroute_net(Net *n)
         }
         else
         {
-            int min_hops = INT_MAX;
-            for (const auto &s : sources)
-            {
-                int min = INT_MAX;
-                for (const auto &cand : path_table_ver2[s.first][sink].cand)
-                {
-                    if (cand.hops < min)
-                    {
-                        min = cand.hops;
-                    }
-                }
-                const int &tmp = min;
-                if (tmp < min_hops && tmp != 0)
-                    min_hops = tmp;
-            }
-
-            for (const auto &s : sources)
-            {
-                int min = path_table_ver2[s.first][sink].cand[0].hops;
-                if (min == min_hops)
-                {
-                    src_candidate.push_back(s.first);
-                }
-            }
-
-            minimum_hop = min_hops;
+            minimum_hop = nearest_sources(sources, sink, src_candidate);
         }
 
         for (const auto &src : src_candidate)
         {
-            const auto &pt_init = path_table_ver2[src][sink];
-            for (const auto &cand : pt_init.cand)
-            {
-                int hops = cand.hops;
-
-                if (hops > minimum_hop + hop_limit)
-                {
-                    continue;
-                }
-
-                for (const auto &par : cand.parent)
-                {
-                    vector<int> path;
-                    path.push_back(sink);
-                    path.push_back(par);
-                    auto pq = make_pair(path, hops - 1);
-                    path_queue.push(pq);
-                }
-            }
-
-            while (!path_queue.empty())
-            {
-                auto cur_path = path_queue.front();
-                path_queue.pop();
-
-                if (cur_path.first.back() == src) //done !
-                {
-                    cand_path.push_back(cur_path.first);
-                    continue;
-                }
-
-                auto pt = path_table_ver2[src][cur_path.first.back()];
-
-                for (auto &cand : pt.cand)
-                {
-                    if (cand.hops == 1 && cand.hops == cur_path.second)
-                    {
-                        auto temp_path = cur_path.first;
-                        temp_path.push_back(src);
-                        cand_path.push_back(temp_path);
-                    }
-                    else if (cand.hops == cur_path.second)
-                    {
-                        for (auto &par : cand.parent)
-                        {
-                            auto temp_path = cur_path.first;
-                            temp_path.push_back(par);
-                            auto pq = make_pair(temp_path, cur_path.second - 1);
-                            path_queue.push(pq);
-                        }
-                    }
-                }
-            }
+            enum_cand_path(src, sink, minimum_hop + hop_limit, cand_buf);
         }
 
         //try all candidate paths and route the best one
         double best = INT_MAX;
-        int index, count = 0;
+        int index = -1;
 
-        for (auto &path : cand_path)
+        for (int k = 0; k < cand_buf.size(); k++)
         {
-            int sink_num;
+            const int *path = cand_buf.path(k);
+            int &path_len = cand_buf.len[k];
 
             //檢查path是否提前連到tree上了導致dummy node
             int check_idx = 1;
-            for (int i = 1; i < path.size(); i++)
+            for (int i = 1; i < path_len; i++)
             {
                 if (sources.count(path[i]) > 0)
                 {
@@ -3907,137 +4776,142 @@ void FPGA_Gr::reroute_net(Net *n)
                 }
             }
             //pop多餘的點
-            if (check_idx < path.size() - 1)
+            if (check_idx < path_len - 1)
             {
-                for (int i = 0; i < path.size() - 1 - check_idx; i++)
-                {
-                    path.pop_back();
-                }
+                path_len = check_idx + 1;
             }
 
-            double cost = compute_cost_for_CCR(*n, path, sb.first, sink_num);
+            cand_buf.order.push_back(make_pair(CCR_cost_lower_bound(path_len, sb.weight), k));
+        }
+        sort(cand_buf.order.begin(), cand_buf.order.end());
+
+        //cost the candidates from the smallest lower bound, a candidate stops being costed once it is over
+        //the best one and the rest are skipped once even their lower bound is, same result as costing all
+        for (const auto &o : cand_buf.order)
+        {
+            if (o.first > best)
+                break;
+
+            const int &k = o.second;
+            const int *path = cand_buf.path(k);
+            const int &path_len = cand_buf.len[k];
+            int sink_num;
+
+            double cost = compute_cost_for_CCR(*n, path, path_len, sb, sink_num, best);
 
-            if (cost < best)
+            if (cost < best || (cost == best && k < index))
             {
                 best = cost;
-                index = count;
+                index = k;
             }
-
-            count++;
         }
 
         //getchar();
 
-        allpaths.push_back(cand_path[index]);
+        if (index < 0)
+        {
+            cout << "[error] function(reroute_net) no candidate path from net " << net_name.get(n->name_id) << " to " << fpga[sink].name() << endl;
+            exit(1);
+        }
 
-        for (size_t i = 0; i < cand_path[index].size() - 1; i++)
+        const vector<int> best_path(cand_buf.path(index), cand_buf.path(index) + cand_buf.len[index]);
+        allpaths.push_back(best_path);
+
+        for (size_t i = 0; i < best_path.size() - 1; i++)
         {
-            if (edge_lut.count(make_pair(cand_path[index][i + 1], cand_path[index][i])) == 0)
+            if (edge_lut.count(make_pair(best_path[i + 1], best_path[i])) == 0)
             {
-                edge_lut[make_pair(cand_path[index][i + 1], cand_path[index][i])] = 1;
-                add_channel_demand(cand_path[index][i + 1], cand_path[index][i]);
+                edge_lut[make_pair(best_path[i + 1], best_path[i])] = 1;
+                add_channel_demand(best_path[i + 1], best_path[i]);
 
                 //不確定對不對
-                auto ch = map_to_channel[get_channel_name(cand_path[index][i + 1], cand_path[index][i])];
-                int dir = (cand_path[index][i + 1] > cand_path[index][i]) ? 1 : 0;
+                auto ch = get_channel(get_channel_name(best_path[i + 1], best_path[i]));
+                int dir = (best_path[i + 1] > best_path[i]) ? 1 : 0;
                 ch->passed_nets[dir].push_back(n);
             }
-            sources[cand_path[index][i]] = 1;
+            sources[best_path[i]] = 1;
         }
 
         total_time += ((double)(clock() - t2) / (double)CLOCKS_PER_SEC);
-        routing_subtree(*n, cand_path[index]); //add path to routing tree
+        routing_subtree(*n, best_path); //add path to routing tree
     }
+
+    update_flat_tree(*n);
 }
 
 void FPGA_Gr::rip_up_net(Net &n)
 {
-    queue<Tree_Node *> fifo_queue;
-    fifo_queue.push(n.rtree_root);
-
     if (n.rtree_root == NULL)
         return;
 
-    while (fifo_queue.size() != 0)
+    //edges of the tree in BFS order
+    for (int k = n.flat_begin + 1; k < n.flat_begin + n.flat_size; k++)
     {
-        Tree_Node *cur = fifo_queue.front();
-        fifo_queue.pop();
+        const int &par_id = flat_tree.fpga_id[n.flat_begin + flat_tree.parent[k]];
+        const int &cur_id = flat_tree.fpga_id[k];
+        sub_channel_demand(par_id, cur_id);
 
-        if (cur->children.size() == 0)
-            continue;
+        //不確定對不對
+        int dir = (par_id > cur_id) ? 1 : 0;
+        auto ch = get_channel(get_channel_name(par_id, cur_id));
+        Net *rm_net;
 
-        for (const auto &child : cur->children)
+        for (auto &ch_passed : ch->passed_nets[dir])
         {
-            sub_channel_demand(cur->fpga_id, child->fpga_id);
-
-            //不確定對不對
-            int dir = (cur->fpga_id > child->fpga_id) ? 1 : 0;
-            auto ch = map_to_channel[get_channel_name(cur->fpga_id, child->fpga_id)];
-            Net *rm_net;
-
-            for (auto &ch_passed : ch->passed_nets[dir])
+            if (ch_passed->id == n.id)
             {
-                if (ch_passed->name == n.name)
-                {
-                    rm_net = ch_passed;
-                    break;
-                }
+                rm_net = ch_passed;
+                break;
             }
-            ch->passed_nets[dir].remove(rm_net);
-
-            fifo_queue.push(child);
         }
-        delete cur;
+        ch->passed_nets[dir].remove(rm_net);
     }
 
+    tree_pool.release_tree(n.rtree_root);
+    n.node_map.clear();
     n.total_tree_edge = 0;
     n.rtree_root = NULL;
+    update_flat_tree(n);
 }
 
-double FPGA_Gr::compute_cost_for_CCR(Net &n, const vector<int> &path, const SubNet &sbnet, int &sink_num)
+double FPGA_Gr::compute_cost_for_CCR(Net &n, const int *path, const int &path_len, const SubNet &sbnet, int &sink_num, const double &bound)
 {
     double cost = 0.0, cost_path = 0.0, appr_tdm = 0.0;
     double weight = sbnet.weight;
-    double hop_num = path.size() - 1;
+    double hop_num = path_len - 1;
     double total_used = 0.0, net_cost = 0.0;
     double total_his_cost = 0.0;
     double total_weight = 0.0;
     double cost_par = 0.0;
     sink_num = 1;
 
-    map<int, int> sink_lut;
-    for (const auto &sk : n.sink)
-    {
-        sink_lut[sk.id] = sk.weight;
-    }
-
-    for (size_t i = 0; i < path.size() - 1; i++)
+    for (int i = 0; i < path_len - 1; i++)
     {
-        int cap = channel_capacity[make_pair(path[i + 1], path[i])];
+        const int e = edge_index(path[i + 1], path[i]);
+        const int &direct = (path[i + 1] < path[i]) ? 0 : 1; //min-->max : 0, max-->min : 1
+        int cap = channel_capacity[2 * e + direct];
 
         cap = (cap == 0) ? 1 : cap;
 
         //double sig_weight = n.edge_crit[make_pair(path[i + 1], path[i])];
-        const int &direct = (path[i + 1] < path[i]) ? 0 : 1; //min-->max : 0, max-->min : 1
-        double ch_used = channel_used(path[i + 1], path[i]);
+        double ch_used = channel_demand[2 * e + direct];
 
         double before_tdm = (double)(ch_used) / (double)cap;
         double appr_tdm = (double)(ch_used + 1) / (double)cap; //src to sink appr. tdm
 
-        auto ch_name = get_channel_name(path[i], path[i + 1]);
-        auto ch = map_to_channel[ch_name];
-        double his_cost = ch->history_cost[direct];
+        double his_cost = history_cost[2 * e + direct];
 
         //check weight
         if (i > 0)
         {
             //check if current node is a sink ?
-            if (sink_lut.count(path[i]) > 0)
+            const int *sink_weight = n.sink_weight(path[i]);
+            if (sink_weight != NULL)
             {
                 sink_num++;
-                if (sink_lut[path[i]] > weight)
+                if (*sink_weight > weight)
                 {
-                    weight = sink_lut[path[i]];
+                    weight = *sink_weight;
                 }
             }
         }
@@ -4052,9 +4926,10 @@ double FPGA_Gr::compute_cost_for_CCR(Net &n, const vector<int> &path, const SubN
 
         //計算net的history channel penalty
         double nch_penalty = 1;
-        if (n.chan_penalty.count(ch_name) > 0) //存在penalty
+        auto penalty = n.chan_penalty.find(e);
+        if (penalty != n.chan_penalty.end()) //存在penalty
         {
-            nch_penalty = n.chan_penalty[ch_name];
+            nch_penalty = penalty->second;
         }
         
         
@@ -4065,9 +4940,17 @@ double FPGA_Gr::compute_cost_for_CCR(Net &n, const vector<int> &path, const SubN
 
         cost_par = cost_cur;
         cost_path += cost_cur;
+
+        //cost can only grow (see compute_cost_for_gr2) and each node left may still be a sink
+        if (cost_path > bound && weight >= 0 && cost_par >= 0)
+        {
+            const double least = cost_path / (double)(sink_num + path_len - 1 - i);
+            if (least > bound)
+                return least;
+        }
     }
 
-    if (sink_lut.count(path.back()) > 0)
+    if (n.sink_weight(path[path_len - 1]) != NULL)
         sink_num++;
 
     cost = cost_path;
@@ -4076,14 +4959,23 @@ double FPGA_Gr::compute_cost_for_CCR(Net &n, const vector<int> &path, const SubN
     return cost;
 }
 
-void FPGA_Gr::add_ch_RRtimes(pair<int, int> ch_name)
+double FPGA_Gr::CCR_cost_lower_bound(const int &path_len, const double &weight)
 {
-    if (RRtimes.count(ch_name) == 0)
-    {
-        RRtimes[ch_name] = 1;
-    }
-    else
+    //every hop of compute_cost_for_CCR adds at least weight (penalty >= 1, tdm >= 1) to cost_par,
+    //and at most every node but the source is a sink
+    if (weight < 0)
+        return -DBL_MAX;
+
+    double cost_par = 0.0, cost_path = 0.0;
+    for (int i = 0; i < path_len - 1; i++)
     {
-        RRtimes[ch_name]++;
+        cost_par = cost_par + weight;
+        cost_path += cost_par;
     }
+    return cost_path / (double)path_len;
+}
+
+void FPGA_Gr::add_ch_RRtimes(const int &e)
+{
+    RRtimes[e]++;
 }
\ No newline at end of file
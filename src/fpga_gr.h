@@ -9,24 +9,68 @@
 #include <deque>
 #include <queue>
 #include <map>
+#include <string>
+#include <tuple>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <condition_variable>
 #include <cmath>
 #include <climits>
+#include <cfloat>
 #include <iomanip>
 #include <time.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 #include "node.h"
 
 #define LIMIT_HOP 1
+#define TABLE_CACHE_VERSION 4
+#define NETLIST_BIN_VERSION 1
 
 using namespace std;
 
 class Channel;
+class FPGA_Gr;
 
 class FPGA
 {
 public:
     int id;
-    vector<pair<int, int>> nbr_pair; //nbr_fpga pairs
-    map<int, int> nbr_index;         //input nbr fpga id --> output fpga index in vector nbr_pair
+    int code; //100 * U + 10 * M + F in input files
+
+    string name() const
+    {
+        return "U" + to_string(code / 100) + "/M" + to_string(code / 10 % 10) + "/F" + to_string(code % 10);
+    }
+};
+
+class CSR_Graph //compressed sparse row adjacency of fpga graph
+{
+public:
+    vector<int> offset; //fpga id --> first index of its row, size = #fpga + 1
+    vector<int> nbr;    //index --> nbr fpga id (sorted in each row)
+    vector<int> edge;   //index --> edge id of the channel
+    vector<int> pairs;  //index --> #pairs of the channel
+
+    int find(const int &s, const int &t) const //return index of t in row s, -1 if not adjacent
+    {
+        auto first = nbr.begin() + offset[s];
+        auto last = nbr.begin() + offset[s + 1];
+        auto it = lower_bound(first, last, t);
+        return (it != last && *it == t) ? it - nbr.begin() : -1;
+    }
 };
 
 class Sink
@@ -48,6 +92,14 @@ public:
     //map<vector<int>, >
 };
 
+class SubNet_Ref //routing order record of net[net_id].sbnet[sb_id]
+{
+public:
+    int weight;
+    int net_id;
+    int sb_id;
+};
+
 class Ch_nets
 {
 public:
@@ -56,11 +108,47 @@ public:
     //double edge_weight;
 };
 
+class Decompress_Stream //reads a plain, gzip or zstd (with USE_ZSTD) file as one byte stream
+{
+public:
+    enum Format
+    {
+        PLAIN,
+        GZIP,
+        ZSTD
+    };
+
+    Format format;
+    gzFile gz; //plain and gzip
+#ifdef USE_ZSTD
+    FILE *fin;
+    ZSTD_DStream *zs;
+    vector<char> in_buf;
+    ZSTD_inBuffer in;
+    size_t zs_ret; //last ZSTD_decompressStream result before the input ran out, 0 : frame complete
+#endif
+
+    static Format detect(const char *); //by magic number
+    Decompress_Stream(const char *);
+    ~Decompress_Stream();
+    size_t read(char *, const size_t &); //return 0 at end of stream
+};
+
+class String_Pool //strings stored back to back, string id --> data[off[id]] ~ data[off[id + 1] - 1]
+{
+public:
+    string data;
+    vector<uint32_t> off;
+
+    String_Pool() : off(1, 0) {}
+    string get(const int &id) const { return data.substr(off[id], off[id + 1] - off[id]); }
+};
+
 class Net
 {
 public:
     int id;
-    string name;
+    int name_id; //FPGA_Gr::net_name
     int source;
     double total_order; //記錄net中所有subnet 前次routing的次序index總和
     double cost;
@@ -72,16 +160,32 @@ public:
     bool ripped[5];
 
     vector<Sink> sink;
+    vector<pair<int, int>> sink_lut; //(sink fpga id, weight) sorted by fpga id, built in breakdown
+    vector<int> sink_first;          //weight of the first sink_lut[k] in sink, used by the routing tree
     vector<SubNet> sbnet;
     vector<pair<int, int>> channels;
     Tree_Node *rtree_root; //routing tree root
+    Tree_Node_Map node_map; //fpga id --> node of the routing tree
+    int flat_begin, flat_size, flat_cap; //routing tree in FPGA_Gr::flat_tree slots flat_begin ~ flat_begin + flat_size - 1, flat_cap slots are held
     map<pair<int, int>, int> edge_crit;
-    map<pair<int, int>, double> chan_penalty;
+    map<int, double> chan_penalty; //edge id --> penalty
 
     int total_tree_edge; //record # of tree edge
     double signal_weight;
     vector<pair<vector<int>, SubNet>> allpaths;
 
+    const int *sink_weight(const int &fpga_id) const //NULL : not a sink of this net
+    {
+        auto it = lower_bound(sink_lut.begin(), sink_lut.end(), make_pair(fpga_id, INT_MIN));
+        return (it != sink_lut.end() && it->first == fpga_id) ? &it->second : NULL;
+    }
+
+    const int *tree_sink_weight(const int &fpga_id) const //NULL : not a sink of this net
+    {
+        auto it = lower_bound(sink_lut.begin(), sink_lut.end(), make_pair(fpga_id, INT_MIN));
+        return (it != sink_lut.end() && it->first == fpga_id) ? &sink_first[it - sink_lut.begin()] : NULL;
+    }
+
     void net_initialize()
     {
         total_tree_edge = 0;
@@ -93,8 +197,13 @@ public:
 
     Net()
     {
+        source = -1;
+        name_id = -1;
         sorted = false;
+        for (auto &r : ripped)
+            r = false;
         rtree_root = NULL;
+        flat_begin = flat_size = flat_cap = 0;
         total_tree_edge = 0;
         total_tdm = 0.0;
         total_edge_weight = 0.0;
@@ -109,38 +218,345 @@ class Channel
 public:
     pair<int, int> name;
     list<pair<Net *, double>> net_ch_weight; //net list and edge weight
-    double history_used[2];                  // min-->max : index=0
-    double history_cost[2];                  //for CCR
-    double history_penalty[2];               //for CCR
-    int capacity;
     list<Net *> passed_nets[2]; //紀錄經過的Net
 
-    Channel()
+    Channel() {}
+
+    ~Channel();
+};
+
+class Table_build_content //candidate hops of a (source, sink) pair (source < sink) while building path table
+{
+public:
+    int hops;
+    vector<int> parent;     //node before sink
+    vector<int> rev_parent; //node after source (parent of sink --> source)
+    Table_build_content()
     {
-        capacity = 0;
-        history_used[0] = history_used[1] = 0.0;
-        history_cost[0] = history_cost[1] = 0.0;
-        history_penalty[0] = history_penalty[1] = 1.0;
+        hops = 0;
     }
+};
 
-    ~Channel();
+typedef vector<Table_build_content> Table_build_cell;
+
+class Table_record //candidate hops of a (source, sink) pair (source < sink) in flat path table
+{
+public:
+    uint32_t par_begin; //index of first parent in Path_Table::par
+    uint16_t hops;
+    uint16_t par_num; //parents of source --> sink, followed by
+    uint16_t rev_num; //parents of sink --> source
+};
+
+class Parent_list //parents of one candidate, points into Path_Table::par
+{
+public:
+    const uint16_t *first, *last;
+
+    const uint16_t *begin() const { return first; }
+    const uint16_t *end() const { return last; }
+    int size() const { return last - first; }
+    int operator[](const int &k) const { return first[k]; }
 };
 
 class Table_content
 {
 public:
     int hops;
-    vector<int> parent;
-    Table_content()
+    Parent_list parent;
+
+    Table_content() {}
+    Table_content(const Table_record &rec, const uint16_t *par, const bool &reverse)
     {
-        hops = 0;
+        hops = rec.hops;
+        parent.first = par + rec.par_begin + (reverse ? rec.par_num : 0);
+        parent.last = parent.first + (reverse ? rec.rev_num : rec.par_num);
+    }
+};
+
+class Cand_list //candidates of a (source, sink) pair sorted by hops, points into Path_Table::rec
+{
+public:
+    const Table_record *first, *last;
+    const uint16_t *par;
+    bool reverse; //sink < source, use the reverse parents of (sink, source)
+
+    class iterator
+    {
+    public:
+        const Table_record *rec;
+        const uint16_t *par;
+        bool reverse;
+        Table_content cur;
+
+        iterator(const Table_record *r, const uint16_t *p, const bool &rev) : rec(r), par(p), reverse(rev) {}
+        const Table_content &operator*()
+        {
+            cur = Table_content(*rec, par, reverse);
+            return cur;
+        }
+        iterator &operator++()
+        {
+            rec++;
+            return *this;
+        }
+        bool operator!=(const iterator &rhs) const { return rec != rhs.rec; }
+    };
+
+    iterator begin() const { return iterator(first, par, reverse); }
+    iterator end() const { return iterator(last, par, reverse); }
+    int size() const { return last - first; }
+    bool empty() const { return first == last; }
+    Table_content operator[](const int &k) const { return Table_content(first[k], par, reverse); }
+};
+
+class Table_row //candidates of one source to every sink, built on demand in lazy mode
+{
+public:
+    vector<uint32_t> cell_off; //sink --> records cell_off[sink] ~ cell_off[sink + 1] - 1
+    vector<Table_record> rec;
+    vector<uint16_t> par;
+
+    size_t bytes() const
+    {
+        return sizeof(Table_row) + cell_off.size() * sizeof(uint32_t) + rec.size() * sizeof(Table_record) + par.size() * sizeof(uint16_t);
+    }
+};
+
+class Dist_row //min hops of every fpga to one fpga (-1 : unreachable), built on demand in lazy mode
+{
+public:
+    vector<int> hops;
+
+    size_t bytes() const { return sizeof(Dist_row) + hops.size() * sizeof(int); }
+};
+
+template <class T>
+class Row_Cache //rows 0 ~ n - 1 shared with their users, least recently used rows are dropped over mem_limit bytes
+{
+public:
+    size_t mem_limit;
+    size_t mem_used;
+    vector<shared_ptr<const T>> row;
+    list<int> lru;
+    vector<list<int>::iterator> lru_pos;
+    mutex row_mutex;
+
+    Row_Cache()
+    {
+        mem_limit = 0;
+        mem_used = 0;
+    }
+
+    void init(const int &n, const size_t &limit)
+    {
+        mem_limit = limit;
+        mem_used = 0;
+        row.assign(n, NULL);
+        lru.clear();
+        lru_pos.assign(n, lru.end());
+    }
+
+    shared_ptr<const T> find(const int &k)
+    {
+        lock_guard<mutex> lock(row_mutex);
+        if (row[k])
+            lru.splice(lru.begin(), lru, lru_pos[k]);
+        return row[k];
+    }
+
+    //keep r as row k, if another thread put row k first its copy is returned instead
+    shared_ptr<const T> insert(const int &k, const shared_ptr<const T> &r)
+    {
+        lock_guard<mutex> lock(row_mutex);
+        if (row[k])
+        {
+            lru.splice(lru.begin(), lru, lru_pos[k]);
+            return row[k];
+        }
+
+        row[k] = r;
+        lru.push_front(k);
+        lru_pos[k] = lru.begin();
+        mem_used += r->bytes();
+
+        //evict least recently used rows, never the one just put
+        while (mem_used > mem_limit && lru.size() > 1)
+        {
+            const int victim = lru.back();
+            lru.pop_back();
+            lru_pos[victim] = lru.end();
+            mem_used -= row[victim]->bytes();
+            row[victim] = NULL;
+        }
+
+        return r;
     }
 };
 
 class Path_table_ver2
 {
 public:
-    vector<Table_content> cand;
+    Cand_list cand;
+};
+
+class Path_Table //flat path table, (source, sink) --> records --> parents
+{
+public:
+    //paths of a pair are the same in both directions, so only pairs i < j are stored
+    //and each record keeps the parents of i --> j and of j --> i
+    int n;
+    vector<uint32_t> cell_off; //cell_index(i, j) --> records cell_off[cell] ~ cell_off[cell + 1] - 1
+    vector<Table_record> rec;
+    vector<uint16_t> par;
+
+    //lazy mode : rows are built by owner when first asked for and kept in LRU caches of about mem_limit bytes in all,
+    //an evicted row stays valid as long as a Row of it is alive
+    bool lazy;
+    FPGA_Gr *owner;
+    size_t mem_limit;
+    mutable Row_Cache<Table_row> row_cache;
+    mutable Row_Cache<Dist_row> dist_cache; //min hops to a sink, the searches of a row need the ones of its sinks
+
+    Path_Table()
+    {
+        n = 0;
+        lazy = false;
+        owner = NULL;
+        mem_limit = (size_t)1 << 30;
+    }
+
+    void set_lazy(FPGA_Gr *, const int &);
+    shared_ptr<const Table_row> get_row(const int &) const;
+    shared_ptr<const Dist_row> get_dist(const int &) const;
+
+    class Row //candidates of one source, fetch it once per source and keep it while its candidates are used
+    {
+    public:
+        const Path_Table *table;
+        int s;
+        shared_ptr<const Table_row> row; //lazy mode only
+
+        Path_table_ver2 operator[](const int &t) const
+        {
+            Path_table_ver2 pt;
+            pt.cand = table->cand_in_row(row.get(), s, t);
+            return pt;
+        }
+    };
+
+    size_t cell_num() const { return (size_t)n * (n - 1) / 2; }
+    size_t cell_index(const int &i, const int &j) const { return (size_t)i * (2 * n - i - 1) / 2 + (j - i - 1); } //i < j
+
+    //candidates of (s, t) without touching the row cache, row must be get_row(s) in lazy mode (unused otherwise)
+    Cand_list cand_in_row(const Table_row *row, const int &s, const int &t) const
+    {
+        Cand_list cand;
+        if (lazy)
+        {
+            cand.par = row->par.data();
+            cand.reverse = false;
+            cand.first = row->rec.data() + row->cell_off[t];
+            cand.last = row->rec.data() + row->cell_off[t + 1];
+            return cand;
+        }
+
+        cand.par = par.data();
+        cand.reverse = s > t;
+        if (s == t)
+        {
+            cand.first = cand.last = rec.data();
+            return cand;
+        }
+
+        const size_t cell = s < t ? cell_index(s, t) : cell_index(t, s);
+        cand.first = rec.data() + cell_off[cell];
+        cand.last = rec.data() + cell_off[cell + 1];
+        return cand;
+    }
+
+    Row operator[](const int &s) const { return Row{this, s, lazy ? get_row(s) : NULL}; }
+};
+
+class Cand_Path_Buffer //candidate paths of one subnet in a flat buffer, reused from subnet to subnet
+{
+public:
+    vector<int> node; //path k : node[off[k]] ~ node[off[k] + len[k] - 1], sink first and source last
+    vector<int> off;
+    vector<int> len;
+    vector<int> src_candidate;
+    vector<pair<double, int>> order; //(cost lower bound, path k), paths are costed in this order
+
+    //BFS levels of partial paths, every partial path of a level has the same length
+    vector<int> front, next;              //partial paths of the current / next level
+    vector<int> front_remain, next_remain; //剩餘hop of each partial path
+
+    void clear()
+    {
+        node.clear();
+        off.clear();
+        len.clear();
+        order.clear();
+    }
+    int size() const { return off.size(); }
+    const int *path(const int &k) const { return node.data() + off[k]; }
+    void add_path(const int *p, const int &l)
+    {
+        off.push_back(node.size());
+        len.push_back(l);
+        node.insert(node.end(), p, p + l);
+    }
+};
+
+class Flat_Tree //routing trees of all nets as parallel arrays in one buffer, each tree in BFS order with its root first
+{
+public:
+    vector<int> fpga_id;
+    vector<int> parent; //slot from the first one of the tree (-1 : root), always before the node
+    vector<int> edge_weight;
+    vector<int> sink_weight;
+    vector<int> max_value;
+    size_t held; //slots held by nets, the others were left by trees moved to the end
+
+    vector<Tree_Node *> node; //scratch of FPGA_Gr::update_flat_tree, nodes in BFS order
+    vector<int> node_parent;  //scratch of FPGA_Gr::update_flat_tree, index of the parent in node
+
+    Flat_Tree() { held = 0; }
+
+    size_t size() const { return fpga_id.size(); }
+    void resize(const size_t &size)
+    {
+        fpga_id.resize(size);
+        parent.resize(size);
+        edge_weight.resize(size);
+        sink_weight.resize(size);
+        max_value.resize(size);
+    }
+    void set(const size_t &slot, const Tree_Node *n, const int &par)
+    {
+        fpga_id[slot] = n->fpga_id;
+        parent[slot] = par;
+        edge_weight[slot] = n->edge_weight;
+        sink_weight[slot] = n->sink_weight;
+        max_value[slot] = n->max_value;
+    }
+    void copy(const Flat_Tree &from, const size_t &from_slot, const size_t &to_slot, const size_t &num)
+    {
+        std::copy(from.fpga_id.begin() + from_slot, from.fpga_id.begin() + from_slot + num, fpga_id.begin() + to_slot);
+        std::copy(from.parent.begin() + from_slot, from.parent.begin() + from_slot + num, parent.begin() + to_slot);
+        std::copy(from.edge_weight.begin() + from_slot, from.edge_weight.begin() + from_slot + num, edge_weight.begin() + to_slot);
+        std::copy(from.sink_weight.begin() + from_slot, from.sink_weight.begin() + from_slot + num, sink_weight.begin() + to_slot);
+        std::copy(from.max_value.begin() + from_slot, from.max_value.begin() + from_slot + num, max_value.begin() + to_slot);
+    }
+    void swap_slots(Flat_Tree &rhs)
+    {
+        fpga_id.swap(rhs.fpga_id);
+        parent.swap(rhs.parent);
+        edge_weight.swap(rhs.edge_weight);
+        sink_weight.swap(rhs.sink_weight);
+        max_value.swap(rhs.max_value);
+        std::swap(held, rhs.held);
+    }
 };
 
 class FPGA_Gr
@@ -151,6 +567,11 @@ public:
     int sink_num;
     int total_demand;
     int capacity;
+    int thread_num;         //worker threads for path table construction
+    string table_cache_dir; //directory of path table cache files (empty or not a directory : no cache)
+    bool lazy_table;        //build path table rows on demand instead of the whole table, no table cache
+    int table_hop_limit;    //candidate paths are at most min hops + table_hop_limit
+    int table_sol_limit;    //at most table_sol_limit + 1 paths are searched for a pair
     double total_cost, avg_sk_weight;
     double avg_tdm_ratio;
     int mintdm, maxtdm;
@@ -158,17 +579,35 @@ public:
     bool subnetbased;
 
     vector<FPGA> fpga;
+    vector<int> code_to_id; //100 * U + 10 * M + F --> fpga id (-1 : not exist)
+    CSR_Graph graph;
     vector<Net> net;
+    Tree_Node_Pool tree_pool; //nodes of all routing trees
+    vector<Tree_Node *> tree_order; //routing tree nodes in BFS order, scratch of compute_edge_weight
+    Flat_Tree flat_tree; //routing trees of all nets, laid out again by update_flat_tree when a net's tree is edited
+    String_Pool net_name; //net names, net.name_id --> name
     vector<SubNet> subnet;
-    vector<vector<Path_table_ver2>> path_table_ver2;
-    map<pair<int, int>, int> channel_demand; //2 fpga --> demand signals
-    map<pair<int, int>, Channel *> map_to_channel;
-    map<pair<int, int>, int> channel_capacity; //2 fpga --> channel capacity
+    Path_Table path_table_ver2;
+    Cand_Path_Buffer cand_buf; //candidate paths of the subnet being routed, reused from subnet to subnet
+    vector<Table_build_cell> table_build; //path_table_ver2.cell_index(i, j) --> candidates, only while building path table
+    vector<int> min_hop; //fpga i * fpga_num + fpga j --> min hops (-1 : unreachable), only while building path table (not used in lazy mode)
+    vector<Channel *> channel; //edge id --> channel
     map<pair<int, int>, int> channel_total_edge_weight;
-    map<pair<int, int>, int> congestion_map;
-    vector<pair<pair<int, int>, int>> cong_map_vec;
-    map<pair<int, int>, int> old_map_vec;
-    map<pair<int, int>, int> RRtimes;
+
+    //channel state indexed by edge id, directed state by edge id * 2 + direct (min-->max : 0, max-->min : 1)
+    int edge_num;
+    vector<pair<int, int>> edge_name; //edge id --> channel name
+    vector<int> edge_capacity;        //edge id --> channel capacity
+    vector<int> channel_demand;       //edge id * 2 + direct --> demand signals
+    vector<int> channel_capacity;     //edge id * 2 + direct --> channel capacity
+    vector<double> history_used;      //edge id * 2 + direct
+    vector<double> history_cost;      //for CCR
+    vector<double> history_penalty;   //for CCR
+    vector<int> congestion_map;       //edge id --> congestion
+    vector<bool> congestion_used;     //edge id --> recorded in congestion map
+    vector<pair<int, int>> cong_map_vec;
+    vector<int> old_map_vec;
+    vector<int> RRtimes;
     vector<int> after_conj_cost;
     vector<int> after_total_weight;
 
@@ -190,10 +629,27 @@ public:
         maxtdm = 0;
         minsgw = mintdm = INT_MAX;
         subnetbased = false;
+        thread_num = max(1, (int)thread::hardware_concurrency());
+        lazy_table = false;
+        table_hop_limit = LIMIT_HOP;
+        table_sol_limit = 5;
     }
     ~FPGA_Gr() {}
     
     void getfile(char *, char *);
+    void read_system_file(char *); //fpgas, channels and capacity
+    void read_netlist(char *);     //nets, needs the system file
+    void build_topology(const vector<int> &, const vector<int> &, const vector<int> &); //links of the system file
+    void finish_netlist(const double &);
+    void getfile_bin(const char *);       //load system and nets from a binary netlist
+    void write_netlist_bin(const char *); //save system and nets as a binary netlist
+    double read_net_file(const char *);                       //return total sink weight
+    double read_net_stream(const char *);                     //compressed net file, return total sink weight
+    double parse_net_line(const char *, const char *, Net &, pair<const char *, const char *> &); //return total sink weight of the net, name field is returned by the last argument
+    int fpga_index(const int &);                //return fpga id of 100 * U + 10 * M + F
+    int edge_index(const int &, const int &);  //return edge id of channel s<-->t
+    int direct_index(const int &, const int &); //return edge id * 2 + direct of channel s-->t
+    Channel *get_channel(const pair<int, int> &);
     void breakdown(); //break down all net into 2 pin subnet
     void construct_table();
     void show_path_table();
@@ -218,15 +674,38 @@ public:
 
     //another global routing
     void construct_table_ver2(); //考慮hops數多1~2的可能
+    void build_min_hop();
+    void bfs_min_hop(const int &, int *, vector<int> &);
+    shared_ptr<const Dist_row> build_dist_row(const int &);
+    void build_path_table();
+    shared_ptr<const Table_row> build_table_row(const int &);
+    void search_table_pair(const int &, const int &, const int *, vector<int> &, vector<char> &, Table_build_cell &);
+    void search_table_path(vector<int> &, vector<char> &, const int &, const int *, const int &, int &, Table_build_cell &);
+    void record_table_path(const vector<int> &, Table_build_cell &);
+    void pack_path_table();
+    uint64_t table_cache_key(const int &, const int &);
+    bool load_table_cache(const string &, const uint64_t &);
+    void save_table_cache(const string &, const uint64_t &);
     void global_routing_ver2();  //考慮tdm(orcd  congestion)
     void show_path_table_ver2();
-    double compute_cost_for_gr2(Net &, const vector<int> &, const SubNet &, int &sink_num);
+    double compute_cost_for_gr2(Net &, const int *, const int &, const SubNet &, int &sink_num, const double &bound = DBL_MAX);
+    double compute_cost_for_gr2(Net &n, const vector<int> &path, const SubNet &sbnet, int &sink_num)
+    {
+        return compute_cost_for_gr2(n, path.data(), path.size(), sbnet, sink_num);
+    }
+    double gr2_cost_lower_bound(const int &, const double &);
 
     //history cost 2020/03/29
     void initial_route_result();
 
     void global_routing_ver3();
     void routing_subtree(Net &, const vector<int> &);
+    void update_flat_tree(Net &);
+    void compact_flat_tree();
+    void map_subtree(Net &, Tree_Node *);
+    void unmap_subtree(Net &, Tree_Node *);
+    void enum_cand_path(const int &, const int &, const int &, Cand_Path_Buffer &);
+    int nearest_sources(const map<int, int> &, const int &, vector<int> &); //sources with the fewest hops to sink, return the hops
 
     //channel direct 2020/04/08
     //void distribute_channel_capacity(); //依比例分配channel的capacity
@@ -244,14 +723,19 @@ public:
     void congestion_RR();
     void rip_up_net(Net &n);
     void reroute_net(Net *n);
-    double compute_cost_for_CCR(Net &, const vector<int> &, const SubNet &, int &sink_num);
+    double compute_cost_for_CCR(Net &, const int *, const int &, const SubNet &, int &sink_num, const double &bound = DBL_MAX);
+    double compute_cost_for_CCR(Net &n, const vector<int> &path, const SubNet &sbnet, int &sink_num)
+    {
+        return compute_cost_for_CCR(n, path.data(), path.size(), sbnet, sink_num);
+    }
+    double CCR_cost_lower_bound(const int &, const double &);
     void update_history_cost();
 
     //2020/08/11
     void set_after_conj_cost();
 
     //2020/09/01
-    void add_ch_RRtimes(pair<int, int>);
+    void add_ch_RRtimes(const int &);
 };
 
 #endif
\ No newline at end of file
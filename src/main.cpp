@@ -25,22 +25,62 @@ int main(int argc, char **argv)
      strcat(f21, num);
      strcat(f21, f22);
 
+     char f31[100] = "../../benchmark/testcase_new/syn";
+     char f32[20] = ".bin";
+     strcat(f31, num);
+     strcat(f31, f32);
+
      strcat(output, num);
      strcat(output, ".out");
 
      //test random
      int multi_round = 3; //跑幾次init route(含第一次)
 
-     cout << "Loading files : " << f11 << endl;
-     cout << "Loading files : " << f21 << endl;
-     fgr.getfile(f11, f21);
-     
+     //./fpga <num> convert : save sy<num>r.csv and syn<num>.csv as binary netlist syn<num>.bin
+     if (argc > 2 && strcmp(argv[2], "convert") == 0)
+     {
+          cout << "Loading files : " << f11 << endl;
+          cout << "Loading files : " << f21 << endl;
+          fgr.getfile(f11, f21);
+          fgr.write_netlist_bin(f31);
+          cout << "Write binary netlist : " << f31 << endl;
+          return 0;
+     }
+
+     //path table of the same system is reused from FPGA_TABLE_CACHE (default ../cache) if the directory exists
+     const char *cache_dir = getenv("FPGA_TABLE_CACHE");
+     fgr.table_cache_dir = cache_dir != NULL ? cache_dir : "../cache";
 
-     fgr.breakdown();
-     cout << "construct path table...";
+     //FPGA_LAZY_TABLE=1 : build path table rows when the router first asks for them (systems whose whole table does not fit in memory)
+     const char *lazy_table = getenv("FPGA_LAZY_TABLE");
+     fgr.lazy_table = lazy_table != NULL && strcmp(lazy_table, "0") != 0;
 
-     /*---------construct path table---------*/
-     fgr.construct_table_ver2();
+     //binary netlist is used when it is newer than both csv files
+     struct stat st_bin, st_sys, st_net;
+     if (stat(f31, &st_bin) == 0 && stat(f11, &st_sys) == 0 && stat(f21, &st_net) == 0 &&
+         st_bin.st_mtime >= st_sys.st_mtime && st_bin.st_mtime >= st_net.st_mtime)
+     {
+          cout << "Loading files : " << f31 << endl;
+          fgr.getfile_bin(f31);
+          fgr.breakdown();
+
+          /*---------construct path table---------*/
+          fgr.construct_table_ver2();
+     }
+     else
+     {
+          cout << "Loading files : " << f11 << endl;
+          cout << "Loading files : " << f21 << endl;
+          fgr.read_system_file(f11);
+
+          /*---------construct path table---------*/
+          //the path table only needs the system file, build it while the nets are read
+          thread table_thread([&fgr]() { fgr.construct_table_ver2(); });
+          fgr.read_netlist(f21);
+          fgr.breakdown();
+          table_thread.join();
+     }
+     cout << "construct path table...OK" << endl;
      cout << "initial routing...";
 
      /*---------global routing---------*/
@@ -4,6 +4,9 @@
 #include <iostream>
 #include <queue>
 #include <list>
+#include <vector>
+#include <memory>
+#include <stdint.h>
 using namespace std;
 
 class Tree_Node
@@ -15,7 +18,7 @@ public:
     int edge_weight;
     bool flag;
     Tree_Node *parent;
-    list<Tree_Node *> children;
+    vector<Tree_Node *> children; //keeps its capacity when the node is recycled by Tree_Node_Pool
 
     Tree_Node() 
     {
@@ -25,4 +28,198 @@ public:
     ~Tree_Node() {}
 };
 
+class Tree_Node_Pool //routing tree nodes of all nets, allocated in chunks and recycled through a free list
+{
+public:
+    static constexpr int CHUNK_SIZE = 4096;
+
+    vector<unique_ptr<Tree_Node[]>> chunk;
+    int chunk_used; //nodes handed out from chunk.back()
+    vector<Tree_Node *> free_node;
+
+    Tree_Node_Pool()
+    {
+        chunk_used = CHUNK_SIZE;
+    }
+
+    Tree_Node *get()
+    {
+        Tree_Node *node;
+        if (!free_node.empty())
+        {
+            node = free_node.back();
+            free_node.pop_back();
+        }
+        else
+        {
+            if (chunk_used == CHUNK_SIZE)
+            {
+                chunk.emplace_back(new Tree_Node[CHUNK_SIZE]);
+                chunk_used = 0;
+            }
+            node = &chunk.back()[chunk_used++];
+        }
+
+        node->sink_weight = 0;
+        node->max_value = 0;
+        node->edge_weight = 0;
+        node->flag = false;
+        node->parent = NULL;
+        node->children.clear();
+        return node;
+    }
+
+    void release(Tree_Node *node)
+    {
+        free_node.push_back(node);
+    }
+
+    void release_tree(Tree_Node *root) //release root and all nodes under it
+    {
+        if (root == NULL)
+            return;
+
+        const size_t first = free_node.size();
+        free_node.push_back(root);
+        for (size_t i = first; i < free_node.size(); i++)
+        {
+            for (const auto &child : free_node[i]->children)
+                free_node.push_back(child);
+        }
+    }
+};
+
+class Tree_Node_Map //fpga id --> node of one routing tree, open addressing with linear probing
+{
+public:
+    //an fpga can be on a tree more than once, cnt counts its nodes and the id keeps the first one mapped;
+    //value NULL : the mapped node was cut while another node of the id is still on the tree (see refill)
+    static constexpr int EMPTY = -1, REMOVED = -2;
+
+    vector<int> key; //fpga id, EMPTY or REMOVED
+    vector<Tree_Node *> value;
+    vector<int> cnt; //nodes of the id on the tree
+    int num;  //ids in the map
+    int used; //ids + REMOVED slots
+
+    Tree_Node_Map()
+    {
+        num = used = 0;
+    }
+
+    size_t slot(const int &id) const { return ((uint32_t)id * 2654435761u) & (key.size() - 1); }
+
+    Tree_Node *find(const int &id) const //NULL : not in the tree
+    {
+        if (key.empty())
+            return NULL;
+
+        for (size_t i = slot(id);; i = (i + 1) & (key.size() - 1))
+        {
+            if (key[i] == id)
+                return value[i];
+            if (key[i] == EMPTY)
+                return NULL;
+        }
+    }
+
+    void insert(const int &id, Tree_Node *node, const int &node_num = 1) //an id already in the map keeps its node
+    {
+        if ((size_t)(used + 1) * 4 > key.size() * 3)
+            rehash();
+
+        size_t removed = key.size();
+        for (size_t i = slot(id);; i = (i + 1) & (key.size() - 1))
+        {
+            if (key[i] == id)
+            {
+                cnt[i] += node_num;
+                if (value[i] == NULL)
+                    value[i] = node;
+                return;
+            }
+            if (key[i] == REMOVED && removed == key.size())
+                removed = i;
+            if (key[i] == EMPTY)
+            {
+                if (removed != key.size())
+                    i = removed;
+                else
+                    used++;
+                key[i] = id;
+                value[i] = node;
+                cnt[i] = node_num;
+                num++;
+                return;
+            }
+        }
+    }
+
+    bool erase(const int &id, const Tree_Node *node) //return true if id lost its node but is still on the tree
+    {
+        if (key.empty())
+            return false;
+
+        for (size_t i = slot(id);; i = (i + 1) & (key.size() - 1))
+        {
+            if (key[i] == id)
+            {
+                if (--cnt[i] == 0)
+                {
+                    key[i] = REMOVED;
+                    num--;
+                    return false;
+                }
+                if (value[i] != node)
+                    return false;
+                value[i] = NULL;
+                return true;
+            }
+            if (key[i] == EMPTY)
+                return false;
+        }
+    }
+
+    void refill(const int &id, Tree_Node *node) //give id node if it lost its node
+    {
+        for (size_t i = slot(id);; i = (i + 1) & (key.size() - 1))
+        {
+            if (key[i] == id)
+            {
+                if (value[i] == NULL)
+                    value[i] = node;
+                return;
+            }
+            if (key[i] == EMPTY)
+                return;
+        }
+    }
+
+    void clear()
+    {
+        key.assign(key.size(), EMPTY);
+        num = used = 0;
+    }
+
+    void rehash() //at most half full afterwards
+    {
+        size_t cap = 16;
+        while ((size_t)(num + 1) * 2 > cap)
+            cap *= 2;
+
+        vector<int> old_key(cap, EMPTY);
+        vector<Tree_Node *> old_value(cap, NULL);
+        vector<int> old_cnt(cap, 0);
+        old_key.swap(key);
+        old_value.swap(value);
+        old_cnt.swap(cnt);
+        num = used = 0;
+        for (size_t i = 0; i < old_key.size(); i++)
+        {
+            if (old_key[i] >= 0)
+                insert(old_key[i], old_value[i], old_cnt[i]);
+        }
+    }
+};
+
 #endif
\ No newline at end of file